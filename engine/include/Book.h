@@ -61,12 +61,9 @@ namespace bq {
                 }
                 if (!match) continue;
              
-                const auto& next = game.moves[m_MoveHistory.size()];
-                MoveList<Us> moves(p);
-                for (const auto& mv : moves) {
-                    if (mv.str() == next) {
-                        return mv;
-                    }
+                const Move mv = p.parse_move(game.moves[m_MoveHistory.size()]);
+                if (p.is_pseudo_legal<Us>(mv) && p.is_legal<Us>(mv)) {
+                    return mv;
                 }
             }
 
@@ -4,13 +4,9 @@
 #include <atomic>
 #include <chrono>
 #include <cstdint>
-#include <thread>
 #include <string>
 #include <vector>
 #include <cstdio>   
-#include <cstdint>
-#include <mutex>
-#include <condition_variable>
 #include "surge.h"
 #include "Search.h"
 #include "Logger.h"
@@ -23,6 +19,8 @@ namespace bq {
         long long wincUs = 0;
         long long bincUs = 0;
         int movestogo = 0;
+        // movetime, go infinite and similar: the side's clock value is this move's whole budget
+        bool fixedBudget = false;
     };
 
     class ChessAi {
@@ -33,6 +31,8 @@ namespace bq {
         long long m_overheadUs = 5'000;
         long long m_minBudgetUs = 2'000;
         long long m_maxFrac = 3;
+        int m_multiPv = 1;
+        Move m_ponderMove;
 
     public:
         explicit ChessAi(Color us, int maxSelDepth = 50)
@@ -44,16 +44,32 @@ namespace bq {
         void setMaxDepth(int d) { m_maxDepth = std::max(1, d); }
         void setOverheadUs(long long us) { m_overheadUs = std::max(0LL, us); }
         void setMinBudgetUs(long long us) { m_minBudgetUs = std::max(0LL, us); }
+        void setMultiPv(int lines) { m_multiPv = std::max(1, lines); m_search.setMultiPv(m_multiPv); }
+        void setInfoCallback(bq::Search::InfoCallback cb) { m_search.setInfoCallback(std::move(cb)); }
+
+        // Pondering must be set before think() is called; ponderhit() switches the running search to its time budget
+        void setPondering(bool pondering) { m_search.setPondering(pondering); }
+        void ponderhit() { m_search.ponderhit(); }
+
+        // Expected reply to the last move returned by think(), null when the PV is too short
+        Move ponderMove() const { return m_ponderMove; }
 
-        // Primary API
-        inline Move think(Position& p, const TimeControl& tc) {
+        // Primary API. limits carries searchmoves, node and mate budgets; its deadlines are filled in from tc.
+        // The book is skipped for restricted searches and in MultiPV analysis.
+        inline Move think(Position& p, const TimeControl& tc, bq::SearchLimits limits = {}) {
 
+            m_ponderMove = Move{};
+
+            // A book move would come back at once, and no bestmove may be sent while pondering
             Move bookMove;
-            if (m_us == WHITE) {
-                bookMove = m_book.getBookMove<WHITE>(p);
-            }
-            else{
-                bookMove = m_book.getBookMove<BLACK>(p);
+            const bool restricted = !limits.searchMoves.empty() || limits.nodes > 0 || limits.mate > 0;
+            if (!restricted && m_multiPv == 1 && !m_search.pondering()) {
+                if (m_us == WHITE) {
+                    bookMove = m_book.getBookMove<WHITE>(p);
+                }
+                else{
+                    bookMove = m_book.getBookMove<BLACK>(p);
+                }
             }
             if (!bookMove.is_null()) {
                 bq::SearchStats stats{};
@@ -67,35 +83,16 @@ namespace bq {
                 logStats(stats);
                 return bookMove;
             }
-            const long long budgetUs = computeBudgetUs(tc);
-
-            std::mutex mx;
-            std::condition_variable cv;
-            bool done = false;
-
-            std::thread timer([&] {
-                if (budgetUs <= 0) {
-                    m_search.signalStop();
-                    return;
-                }
-                std::unique_lock<std::mutex> lk(mx);
-                if (!cv.wait_for(lk, std::chrono::microseconds(budgetUs), [&] { return done; })) {
-                    m_search.signalStop();
-                }
-                });
+            const bq::SearchLimits timed = computeLimits(tc);
+            limits.softDeadline = timed.softDeadline;
+            limits.hardDeadline = timed.hardDeadline;
 
             bq::SearchStats stats{};
-            if (m_us == WHITE) stats = m_search.initiateIterativeSearch<WHITE>(p, m_maxDepth);
-            else              stats = m_search.initiateIterativeSearch<BLACK>(p, m_maxDepth);
-
-            {
-                std::lock_guard<std::mutex> lk(mx);
-                done = true;
-            }
-            cv.notify_one();
-            timer.join();
+            if (m_us == WHITE) stats = m_search.initiateIterativeSearch<WHITE>(p, m_maxDepth, limits);
+            else              stats = m_search.initiateIterativeSearch<BLACK>(p, m_maxDepth, limits);
 
             logStats(stats);
+            if (stats.pvLen >= 2) m_ponderMove = stats.pv[1];
             return stats.selectedMove;
         }
 
@@ -103,7 +100,7 @@ namespace bq {
             TimeControl tc{};
             if (m_us == WHITE) tc.wtimeUs = budgetUs;
             else               tc.btimeUs = budgetUs;
-            tc.movestogo = 1;
+            tc.fixedBudget = true;
             setOverheadUs(0);
             return think(p, tc);
         }
@@ -113,33 +110,47 @@ namespace bq {
         inline void stop() {
             m_search.signalStop();
         }
+        // Call before think() is started on another thread; a stop() sent after this is kept for that search
+        inline void clearStop() {
+            m_search.clearStop();
+        }
         inline void addBookMove(Move move) {
             m_book.addMove(move);
         }
     private:
-        inline long long computeBudgetUs(const TimeControl& tc) const {
+        // Soft limit: the usual share of the clock for one move, which the search stretches or shrinks.
+        // Hard limit: the most a single move may take. A fixed budget (movetime) is spent whole.
+        inline bq::SearchLimits computeLimits(const TimeControl& tc) const {
+            const auto now = bq::SearchLimits::Clock::now();
+
             long long timeUs = (m_us == WHITE) ? tc.wtimeUs : tc.btimeUs;
             long long incUs = (m_us == WHITE) ? tc.wincUs : tc.bincUs;
 
             timeUs = std::max(0LL, timeUs);
             incUs = std::max(0LL, incUs);
 
-            long long budget = 0;
+            long long softUs = 0;
+            long long hardUs = 0;
 
-            if (tc.movestogo > 0) {
-                const int mtg = std::max(1, tc.movestogo);
-                budget = (timeUs / (mtg + 3)) + (incUs / 2);
+            if (tc.fixedBudget) {
+                softUs = timeUs;
+                hardUs = timeUs;
             }
             else {
-                budget = (timeUs / 30) + (incUs / 2);
+                const int mtg = (tc.movestogo > 0) ? tc.movestogo + 2 : 30;
+                softUs = (timeUs / mtg) + (incUs * 3 / 4);
+                hardUs = softUs * 5;
+                if (m_maxFrac > 0) hardUs = std::min(hardUs, timeUs / m_maxFrac);
+                softUs = std::min(softUs, hardUs);
             }
 
-            if (m_maxFrac > 0) budget = std::min(budget, timeUs / m_maxFrac);
-            budget = std::max(budget, m_minBudgetUs);
-
-            budget = std::max(0LL, budget - m_overheadUs);
+            softUs = std::max(0LL, std::max(softUs, m_minBudgetUs) - m_overheadUs);
+            hardUs = std::max(0LL, std::max(hardUs, m_minBudgetUs) - m_overheadUs);
 
-            return budget;
+            bq::SearchLimits limits;
+            limits.softDeadline = now + std::chrono::microseconds(softUs);
+            limits.hardDeadline = now + std::chrono::microseconds(hardUs);
+            return limits;
         }
 
         static constexpr const char* scoreUnit(bool mateFound) {
@@ -193,7 +204,7 @@ namespace bq {
             constexpr std::size_t W3 = 28;
 
             std::string f1a = "depth: " + std::to_string(s.depth);
-            if (s.depth == 0) f1a = "depth: 0(book)";
+            if (s.depth == 0 && s.nodesSearched == 0) f1a = "depth: 0(book)";
 
             std::string f2a = std::string("score: ") + scoreBuf + " " + unit;
             std::string f3a = "time: " + std::to_string(ms) + "ms";
@@ -272,9 +283,7 @@ namespace bq {
 
         template <Color Us>
         inline bool isLegalMoveFor(Position& p, Move m) const {
-            MoveList<Us> ml(p);
-            for (Move x : ml) if (x == m) return true;
-            return false;
+            return p.is_pseudo_legal<Us>(m) && p.is_legal<Us>(m);
         }
 
         inline bool isLegalSelectedMove(Position& p, Move m) const {
@@ -0,0 +1,42 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+
+#include "surge.h"
+
+namespace bq {
+
+    // Pawn-structure correction history: how far search results have been from the static eval in positions with
+    // the same pawns and side to move. The average error is added to later static evals of such positions.
+    // Entries are in 1/GRAIN centipawns and kept within +-LIMIT by the same "gravity" update as HistoryTable.
+    class CorrectionHistory {
+    public:
+        static constexpr int SIZE = 16'384; // per side, power of two
+        static constexpr int GRAIN = 8;
+        static constexpr int LIMIT = 1'024;
+        static constexpr int MAX_BONUS = LIMIT / 4;
+
+        int correct(Color c, std::uint64_t pawnKey, int eval) const {
+            return eval + m_table[c][index(pawnKey)] / GRAIN;
+        }
+
+        // Moves the entry towards the error found by a search of the given depth
+        void update(Color c, std::uint64_t pawnKey, int depth, int searchScore, int staticEval) {
+            const int bonus = std::clamp((searchScore - staticEval) * depth / 8, -MAX_BONUS, MAX_BONUS);
+            int& v = m_table[c][index(pawnKey)];
+            v += bonus - v * std::abs(bonus) / LIMIT;
+        }
+
+        void clear() {
+            for (auto& side : m_table) side.fill(0);
+        }
+
+    private:
+        static std::size_t index(std::uint64_t pawnKey) { return std::size_t(pawnKey & (SIZE - 1)); }
+
+        std::array<std::array<int, SIZE>, NCOLORS> m_table{};
+    };
+
+} // namespace bq
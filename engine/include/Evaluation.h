@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+
 #include "surge.h"
 #include "tables.h"
 
@@ -15,13 +17,13 @@ namespace bq {
             const Bitboard usBB = pos.all_pieces<Us>();
             const Bitboard thBB = pos.all_pieces<Them>();
 
-            const int phase = ComputePhase(pos);
+            // Material and piece-square terms are kept up to date by the position itself
+            const int phase = std::min(pos.game_phase(), 24);
+            const Score psq = (Us == WHITE) ? pos.psq_score() : -pos.psq_score();
 
-            int mg = 0;
-            int eg = 0;
+            int mg = mg_value(psq);
+            int eg = eg_value(psq);
 
-            AddMaterial<Us>(pos, mg, eg);
-            AddPieceSquareTables<Us>(pos, mg, eg);
             AddMobility<Us>(pos, occ, usBB, thBB, mg, eg);
             AddPawnStructure<Us>(pos, mg, eg);
             AddBishopPair<Us>(pos, mg, eg);
@@ -33,12 +35,6 @@ namespace bq {
         }
 
     private:
-        static constexpr int MirrorSq(int sq) { return sq ^ 56; } // rank flip
-
-        static int Pst(const int* table, Color c, int sq) {
-            return (c == WHITE) ? table[sq] : table[MirrorSq(sq)];
-        }
-
         static constexpr int FileOfSq(int sq) { return sq & 7; }
         static constexpr int RankOfSq(int sq) { return sq >> 3; }
 
@@ -51,195 +47,6 @@ namespace bq {
             return (mg * phase + eg * (24 - phase)) / 24;
         }
 
-        static int ComputePhase(const Position& pos) {
-            static constexpr int PHASE_W[6] = { 0, 1, 1, 2, 4, 0 }; // P,N,B,R,Q,K
-            int phase = 0;
-
-            for (PieceType pt = PAWN; pt < KING; ++pt) {
-                phase += pop_count(pos.bitboard_of(WHITE, pt)) * PHASE_W[pt];
-                phase += pop_count(pos.bitboard_of(BLACK, pt)) * PHASE_W[pt];
-            }
-
-            if (phase > 24) phase = 24;
-            return phase;
-        }
-
-        template <Color Us>
-        static void AddMaterial(const Position& pos, int& mg, int& eg) {
-            constexpr Color Them = ~Us;
-
-            static constexpr int MG_VAL[6] = { 100, 320, 330, 500, 900, 0 };
-            static constexpr int EG_VAL[6] = { 120, 300, 320, 520, 900, 0 };
-
-            for (PieceType pt = PAWN; pt < KING; ++pt) {
-                mg += pop_count(pos.bitboard_of(Us, pt)) * MG_VAL[pt];
-                mg -= pop_count(pos.bitboard_of(Them, pt)) * MG_VAL[pt];
-
-                eg += pop_count(pos.bitboard_of(Us, pt)) * EG_VAL[pt];
-                eg -= pop_count(pos.bitboard_of(Them, pt)) * EG_VAL[pt];
-            }
-        }
-
-        template <Color Us>
-        static void AddPieceSquareTables(const Position& pos, int& mg, int& eg) {
-            constexpr Color Them = ~Us;
-
-            static constexpr int MG_PAWN[64] = {
-                 0,  0,  0,  0,  0,  0,  0,  0,
-                10, 10, 10,-10,-10, 10, 10, 10,
-                 5,  5, 10, 20, 20, 10,  5,  5,
-                 0,  0,  0, 25, 25,  0,  0,  0,
-                 5, -5,-10, 10, 10,-10, -5,  5,
-                 5, 10, 10,-20,-20, 10, 10,  5,
-                10, 10, 10,-10,-10, 10, 10, 10,
-                 0,  0,  0,  0,  0,  0,  0,  0
-            };
-            static constexpr int EG_PAWN[64] = {
-                 0,  0,  0,  0,  0,  0,  0,  0,
-                20, 20, 20, 20, 20, 20, 20, 20,
-                15, 15, 15, 15, 15, 15, 15, 15,
-                10, 10, 10, 12, 12, 10, 10, 10,
-                 6,  6,  6,  8,  8,  6,  6,  6,
-                 3,  3,  3,  4,  4,  3,  3,  3,
-                 1,  1,  1,  0,  0,  1,  1,  1,
-                 0,  0,  0,  0,  0,  0,  0,  0
-            };
-
-            static constexpr int MG_KNIGHT[64] = {
-               -50,-40,-30,-30,-30,-30,-40,-50,
-               -40,-20,  0,  0,  0,  0,-20,-40,
-               -30,  0, 10, 15, 15, 10,  0,-30,
-               -30,  5, 15, 20, 20, 15,  5,-30,
-               -30,  0, 15, 20, 20, 15,  0,-30,
-               -30,  5, 10, 15, 15, 10,  5,-30,
-               -40,-20,  0,  5,  5,  0,-20,-40,
-               -50,-40,-30,-30,-30,-30,-40,-50
-            };
-            static constexpr int EG_KNIGHT[64] = {
-               -40,-30,-20,-20,-20,-20,-30,-40,
-               -30,-10,  0,  0,  0,  0,-10,-30,
-               -20,  0, 10, 10, 10, 10,  0,-20,
-               -20,  0, 10, 15, 15, 10,  0,-20,
-               -20,  0, 10, 15, 15, 10,  0,-20,
-               -20,  0, 10, 10, 10, 10,  0,-20,
-               -30,-10,  0,  0,  0,  0,-10,-30,
-               -40,-30,-20,-20,-20,-20,-30,-40
-            };
-
-            static constexpr int MG_BISHOP[64] = {
-               -20,-10,-10,-10,-10,-10,-10,-20,
-               -10,  0,  0,  0,  0,  0,  0,-10,
-               -10,  0,  5, 10, 10,  5,  0,-10,
-               -10,  5,  5, 10, 10,  5,  5,-10,
-               -10,  0, 10, 10, 10, 10,  0,-10,
-               -10, 10, 10, 10, 10, 10, 10,-10,
-               -10,  5,  0,  0,  0,  0,  5,-10,
-               -20,-10,-10,-10,-10,-10,-10,-20
-            };
-            static constexpr int EG_BISHOP[64] = {
-               -20,-10,-10,-10,-10,-10,-10,-20,
-               -10,  0,  0,  0,  0,  0,  0,-10,
-               -10,  0, 10, 10, 10, 10,  0,-10,
-               -10,  0, 10, 15, 15, 10,  0,-10,
-               -10,  0, 10, 15, 15, 10,  0,-10,
-               -10,  0, 10, 10, 10, 10,  0,-10,
-               -10,  0,  0,  0,  0,  0,  0,-10,
-               -20,-10,-10,-10,-10,-10,-10,-20
-            };
-
-            static constexpr int MG_ROOK[64] = {
-                 0,  0,  0,  5,  5,  0,  0,  0,
-                -5,  0,  0,  0,  0,  0,  0, -5,
-                -5,  0,  0,  0,  0,  0,  0, -5,
-                -5,  0,  0,  0,  0,  0,  0, -5,
-                -5,  0,  0,  0,  0,  0,  0, -5,
-                -5,  0,  0,  0,  0,  0,  0, -5,
-                 5, 10, 10, 10, 10, 10, 10,  5,
-                 0,  0,  0,  0,  0,  0,  0,  0
-            };
-            static constexpr int EG_ROOK[64] = {
-                 0,  0,  0,  5,  5,  0,  0,  0,
-                 0,  0,  0,  0,  0,  0,  0,  0,
-                 0,  0,  0,  0,  0,  0,  0,  0,
-                 0,  0,  0,  0,  0,  0,  0,  0,
-                 0,  0,  0,  0,  0,  0,  0,  0,
-                 0,  0,  0,  0,  0,  0,  0,  0,
-                 5,  5,  5,  5,  5,  5,  5,  5,
-                 0,  0,  0,  0,  0,  0,  0,  0
-            };
-
-            static constexpr int MG_QUEEN[64] = {
-               -20,-10,-10, -5, -5,-10,-10,-20,
-               -10,  0,  0,  0,  0,  0,  0,-10,
-               -10,  0,  5,  5,  5,  5,  0,-10,
-                -5,  0,  5,  5,  5,  5,  0, -5,
-                 0,  0,  5,  5,  5,  5,  0, -5,
-               -10,  5,  5,  5,  5,  5,  0,-10,
-               -10,  0,  5,  0,  0,  0,  0,-10,
-               -20,-10,-10, -5, -5,-10,-10,-20
-            };
-            static constexpr int EG_QUEEN[64] = {
-               -20,-10,-10, -5, -5,-10,-10,-20,
-               -10,  0,  0,  0,  0,  0,  0,-10,
-               -10,  0,  5,  5,  5,  5,  0,-10,
-                -5,  0,  5,  5,  5,  5,  0, -5,
-                 0,  0,  5,  5,  5,  5,  0, -5,
-               -10,  0,  5,  5,  5,  5,  0,-10,
-               -10,  0,  0,  0,  0,  0,  0,-10,
-               -20,-10,-10, -5, -5,-10,-10,-20
-            };
-
-            static constexpr int MG_KING[64] = {
-                20, 30, 10,  0,  0, 10, 30, 20,
-                20, 20,  0,  0,  0,  0, 20, 20,
-               -10,-20,-20,-20,-20,-20,-20,-10,
-               -20,-30,-30,-40,-40,-30,-30,-20,
-               -30,-40,-40,-50,-50,-40,-40,-30,
-               -30,-40,-40,-50,-50,-40,-40,-30,
-               -30,-40,-40,-50,-50,-40,-40,-30,
-               -30,-40,-40,-50,-50,-40,-40,-30
-            };
-            static constexpr int EG_KING[64] = {
-               -50,-30,-30,-30,-30,-30,-30,-50,
-               -30,-10,  0,  0,  0,  0,-10,-30,
-               -30,  0, 10, 15, 15, 10,  0,-30,
-               -30,  0, 15, 25, 25, 15,  0,-30,
-               -30,  0, 15, 25, 25, 15,  0,-30,
-               -30,  0, 10, 15, 15, 10,  0,-30,
-               -30,-10,  0,  0,  0,  0,-10,-30,
-               -50,-30,-30,-30,-30,-30,-30,-50
-            };
-
-            auto AddPst = [&](Color c, PieceType pt, const int* mgT, const int* egT, int sign) {
-                Bitboard b = pos.bitboard_of(c, pt);
-                while (b) {
-                    int sq = int(pop_lsb(&b));
-                    mg += sign * Pst(mgT, c, sq);
-                    eg += sign * Pst(egT, c, sq);
-                }
-                };
-
-            AddPst(Us, PAWN, MG_PAWN, EG_PAWN, +1);
-            AddPst(Them, PAWN, MG_PAWN, EG_PAWN, -1);
-            AddPst(Us, KNIGHT, MG_KNIGHT, EG_KNIGHT, +1);
-            AddPst(Them, KNIGHT, MG_KNIGHT, EG_KNIGHT, -1);
-            AddPst(Us, BISHOP, MG_BISHOP, EG_BISHOP, +1);
-            AddPst(Them, BISHOP, MG_BISHOP, EG_BISHOP, -1);
-            AddPst(Us, ROOK, MG_ROOK, EG_ROOK, +1);
-            AddPst(Them, ROOK, MG_ROOK, EG_ROOK, -1);
-            AddPst(Us, QUEEN, MG_QUEEN, EG_QUEEN, +1);
-            AddPst(Them, QUEEN, MG_QUEEN, EG_QUEEN, -1);
-
-            {
-                int usK = int(bsf(pos.bitboard_of(Us, KING)));
-                int thK = int(bsf(pos.bitboard_of(Them, KING)));
-                mg += Pst(MG_KING, Us, usK);
-                eg += Pst(EG_KING, Us, usK);
-                mg -= Pst(MG_KING, Them, thK);
-                eg -= Pst(EG_KING, Them, thK);
-            }
-        }
-
         template <Color Us>
         static void AddMobility(const Position& pos, Bitboard occ, Bitboard usBB, Bitboard thBB, int& mg, int& eg) {
             constexpr Color Them = ~Us;
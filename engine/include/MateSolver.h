@@ -0,0 +1,271 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "surge.h"
+
+namespace bq {
+
+    struct MateResult {
+        bool proven = false;      // the side to move mates within the limit
+        bool refuted = false;     // no mate within the limit; neither flag is set when the budget ran out
+        int moves = 0;            // length of the proven mate
+        std::vector<Move> line;   // attacker and defender moves, ending in mate
+        long long nodes = 0;
+        long long timeUs = 0;
+    };
+
+    // Depth-first proof-number search (df-pn) for "mate in N" problems, independent of the alpha-beta search.
+    // The side to move is the attacker. Each node keeps a proof and a disproof number (phi/delta, seen from
+    // the side to move there) and the search always expands the child that is cheapest to settle.
+    // Entries are keyed by position and plies left, so the search graph has no cycles and a result stays
+    // valid from one mate length to the next. Mate lengths are tried from 1 up, so a proven mate is a shortest one.
+    class MateSolver {
+    public:
+        static constexpr std::size_t defaultSizeMb = 16;
+
+        MateSolver() { resizeMB(defaultSizeMb); }
+        explicit MateSolver(std::size_t sizeMb) { resizeMB(sizeMb); }
+
+        void resizeMB(std::size_t mb) {
+            std::size_t entries = 1;
+            while (entries * 2 * sizeof(Entry) <= mb * 1024ULL * 1024ULL) entries *= 2;
+            m_table.assign(entries, Entry{});
+        }
+
+        void clear() { std::fill(m_table.begin(), m_table.end(), Entry{}); }
+
+        // May be called from another thread while solve() runs. The stop holds, for later solves too, until
+        // clearStop(); call that before handing a solve to another thread so an early stop is not lost.
+        void stop() { m_stop.store(true, std::memory_order_relaxed); }
+        void clearStop() { m_stop.store(false, std::memory_order_relaxed); }
+        bool stopped() const { return m_stop.load(std::memory_order_relaxed); }
+
+        // Looks for a mate in at most maxMoves moves; maxNodes 0 means no node budget
+        template<Color us>
+        MateResult solve(Position& p, int maxMoves, long long maxNodes = 0) {
+            const auto start = std::chrono::steady_clock::now();
+            m_nodes = 0;
+            m_maxNodes = maxNodes;
+            m_outOfNodes = false;
+
+            MateResult result;
+            for (int moves = 1; moves <= maxMoves; ++moves) {
+                const int plies = 2 * moves - 1;
+                mid<us>(p, plies, true, INF, INF);
+
+                const Entry e = probe(key(p, plies));
+                if (e.phi == 0) {
+                    result.proven = true;
+                    result.moves = moves;
+                    buildLine<us>(p, plies, true, result.line);
+                    break;
+                }
+                if (e.delta != 0) break; // out of budget
+                if (moves == maxMoves) result.refuted = true;
+            }
+
+            result.nodes = m_nodes;
+            result.timeUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            return result;
+        }
+
+    private:
+        static constexpr std::uint32_t INF = 1u << 30;
+
+        struct Entry {
+            std::uint64_t key = 0;
+            std::uint32_t phi = 1;
+            std::uint32_t delta = 1;
+        };
+
+        std::vector<Entry> m_table;
+        std::atomic<bool> m_stop{ false };
+        bool m_outOfNodes = false;
+        long long m_nodes = 0;
+        long long m_maxNodes = 0;
+
+        // Stopped from outside or out of node budget
+        bool halted() const { return m_outOfNodes || m_stop.load(std::memory_order_relaxed); }
+
+        static std::uint64_t key(const Position& p, int plies) {
+            return p.get_hash() ^ (0x9E37'79B9'7F4A'7C15ULL * std::uint64_t(plies + 1));
+        }
+
+        Entry probe(std::uint64_t k) const {
+            const Entry& e = m_table[k & (m_table.size() - 1)];
+            return e.key == k ? e : Entry{ k, 1, 1 };
+        }
+
+        void store(std::uint64_t k, std::uint32_t phi, std::uint32_t delta) {
+            m_table[k & (m_table.size() - 1)] = Entry{ k, phi, delta };
+        }
+
+        // The moves worth trying: on the attacker's last move only checks can mate
+        template<Color us>
+        static int candidates(Position& p, int plies, bool attacker, Move* out) {
+            MoveList<us> list(p);
+            int n = 0;
+            for (Move m : list) {
+                if (attacker && plies == 1 && !p.gives_check<us>(m))
+                    continue;
+                out[n++] = m;
+            }
+            return n;
+        }
+
+        // Settles a node outright when it can be; returns false when it has to be searched
+        template<Color us>
+        bool terminal(Position& p, int plies, bool attacker, int moveCount, std::uint32_t& phi, std::uint32_t& delta) {
+            bool moverWins;
+            if (moveCount == 0)
+                moverWins = !attacker && !p.in_check<us>(); // stalemate saves the defender
+            else if (!attacker && plies == 0)
+                moverWins = true; // not mated and the attacker is out of moves
+            else
+                return false;
+
+            phi = moverWins ? 0 : INF;
+            delta = moverWins ? INF : 0;
+            return true;
+        }
+
+        // Multiple iterative deepening: searches the node until phi >= thPhi or delta >= thDelta
+        template<Color us>
+        void mid(Position& p, int plies, bool attacker, std::uint32_t thPhi, std::uint32_t thDelta) {
+            if (++m_nodes == m_maxNodes) m_outOfNodes = true;
+
+            const std::uint64_t k = key(p, plies);
+
+            Move moves[218];
+            const int n = candidates<us>(p, plies, attacker, moves);
+
+            std::uint32_t phi, delta;
+            if (terminal<us>(p, plies, attacker, n, phi, delta)) {
+                store(k, phi, delta);
+                return;
+            }
+
+            std::uint64_t childKeys[218];
+            for (int i = 0; i < n; ++i) {
+                p.play<us>(moves[i]);
+                childKeys[i] = key(p, plies - 1);
+                p.undo<us>(moves[i]);
+            }
+
+            while (true) {
+                // phi is the cheapest way to win: the child whose mover is closest to losing.
+                // delta is the cost of refuting every move: the sum of the children's phi.
+                int best = 0;
+                std::uint32_t bestDelta = INF, secondDelta = INF, bestPhi = 0;
+                std::uint64_t sumPhi = 0;
+                bool won = false;
+                for (int i = 0; i < n; ++i) {
+                    const Entry c = probe(childKeys[i]);
+                    sumPhi += c.phi;
+                    won |= (c.phi == INF);
+                    if (c.delta < bestDelta) {
+                        secondDelta = bestDelta;
+                        bestDelta = c.delta;
+                        bestPhi = c.phi;
+                        best = i;
+                    }
+                    else if (c.delta < secondDelta) {
+                        secondDelta = c.delta;
+                    }
+                }
+                phi = bestDelta;
+                // A large sum over open children must not look like a won node
+                delta = won ? INF : std::uint32_t(std::min<std::uint64_t>(sumPhi, INF - 1));
+
+                if (phi >= thPhi || delta >= thDelta || halted())
+                    break;
+
+                const std::uint32_t childThPhi = thDelta - delta + bestPhi;
+                const std::uint32_t childThDelta = std::min<std::uint32_t>(thPhi, secondDelta + 1);
+
+                p.play<us>(moves[best]);
+                mid<~us>(p, plies - 1, !attacker, childThPhi, childThDelta);
+                p.undo<us>(moves[best]);
+            }
+
+            store(k, phi, delta);
+        }
+
+        // Whether the attacker wins the node within the given plies, searching it again if the table has lost it
+        template<Color us>
+        bool mates(Position& p, int plies, bool attacker) {
+            Entry e = probe(key(p, plies));
+            if (e.phi != 0 && e.delta != 0) {
+                mid<us>(p, plies, attacker, INF, INF);
+                e = probe(key(p, plies));
+            }
+            return attacker ? e.phi == 0 : e.delta == 0;
+        }
+
+        // Plies of the fastest mate the table already knows for the attacker to move, maxPlies if none is stored
+        int knownMate(const Position& p, int maxPlies) const {
+            for (int plies = 1; plies < maxPlies; plies += 2)
+                if (probe(key(p, plies)).phi == 0) return plies;
+            return maxPlies;
+        }
+
+        // Walks the proof tree from a proven node: the attacker takes the fastest mate and the defender the reply
+        // that puts it off longest, as far as the table knows. Proofs lost from the table are searched again.
+        template<Color us>
+        void buildLine(Position& p, int plies, bool attacker, std::vector<Move>& line) {
+            if (halted())
+                return;
+
+            Move moves[218];
+            int n = 0;
+            const Move* pick = nullptr;
+            int next = 0;
+
+            if (attacker) {
+                // A stored proof first; searching a move that does not mate could take as long as the solve
+                auto mateIn = [&](int k) {
+                    n = candidates<us>(p, k, true, moves);
+                    for (bool search : { false, true }) {
+                        pick = std::find_if(moves, moves + n, [&](Move m) {
+                            p.play<us>(m);
+                            const bool mate = search ? mates<~us>(p, k - 1, false) : probe(key(p, k - 1)).delta == 0;
+                            p.undo<us>(m);
+                            return mate;
+                        });
+                        if (pick != moves + n) break;
+                    }
+                    next = k - 1;
+                    return pick != moves + n;
+                };
+                const int fastest = knownMate(p, plies);
+                if (!mateIn(fastest) && (fastest == plies || !mateIn(plies)))
+                    return;
+            }
+            else {
+                n = candidates<us>(p, plies, false, moves);
+                for (int i = 0; i < n; ++i) {
+                    p.play<us>(moves[i]);
+                    const int len = knownMate(p, plies - 1);
+                    p.undo<us>(moves[i]);
+                    if (len > next) {
+                        next = len;
+                        pick = moves + i;
+                    }
+                }
+                if (!pick)
+                    return; // mated
+            }
+
+            line.push_back(*pick);
+            p.play<us>(*pick);
+            buildLine<~us>(p, next, !attacker, line);
+            p.undo<us>(*pick);
+        }
+    };
+
+}
@@ -2,6 +2,7 @@
 #include <array>
 #include <algorithm>
 #include <cstdint>
+#include <cstdlib>
 
 #include "surge.h"
 #include "TranspositionTable.h"
@@ -13,8 +14,39 @@ namespace bq {
         Move move;
     };
 
+    // Butterfly history for quiet moves, indexed by [side][from][to].
+    // Updated with the "gravity" formula so values stay within +-kMax.
+    class HistoryTable {
+    public:
+        static constexpr int kMax = 16'384;
+
+        int get(Color c, Move m) const { return m_table[c][m.from()][m.to()]; }
+
+        void update(Color c, Move m, int bonus) {
+            int& v = m_table[c][m.from()][m.to()];
+            bonus = std::clamp(bonus, -kMax, kMax);
+            v += bonus - v * std::abs(bonus) / kMax;
+        }
+
+        // Halve everything between searches so old results fade out
+        void age() {
+            for (auto& side : m_table)
+                for (auto& from : side)
+                    for (int& v : from) v /= 2;
+        }
+
+        void clear() {
+            for (auto& side : m_table)
+                for (auto& from : side)
+                    from.fill(0);
+        }
+
+    private:
+        std::array<std::array<std::array<int, NSQUARES>, NSQUARES>, NCOLORS> m_table{};
+    };
+
     template <Color Us>
-    static inline int scoreMove(Move m, Move ttMove)
+    static inline int scoreMove(Move m, Move ttMove, const HistoryTable* history)
     {
         int s = 0;
 
@@ -26,29 +58,36 @@ namespace bq {
 
         if (m.is_capture())
             s += 100'000;
-        else if (m.flags() != QUIET)
-            s += 10'000;
+        else {
+            if (m.flags() != QUIET)
+                s += 10'000;
+            if (history)
+                s += history->get(Us, m);
+        }
 
         return s;
     }
 
+    // Sorts [first, last) best first, using scored as scratch space for the scores.
+    // Killers rank below captures and above the other quiet moves.
     template <Color Us>
-    inline void orderMoves(MoveList<Us>& moves, Move ttMove = Move{})
+    inline void orderMoves(Move* first, Move* last, ScoredMove* scored, Move ttMove = Move{},
+        const HistoryTable* history = nullptr, const std::array<Move, 2>* killers = nullptr)
     {
-        Move* first = moves.begin();
-        Move* last = moves.end();
         const int n = int(last - first);
         if (n <= 1) return;
 
-        // MoveList max is 218 in your code
-        std::array<ScoredMove, 218> scored;
-
         for (int i = 0; i < n; ++i) {
             const Move m = first[i];
-            scored[i] = { scoreMove<Us>(m, ttMove), m };
+            int s = scoreMove<Us>(m, ttMove, history);
+            if (killers && !m.is_capture() && !m.is_promotion()) {
+                if (m == (*killers)[0]) s += 90'000;
+                else if (m == (*killers)[1]) s += 80'000;
+            }
+            scored[i] = { s, m };
         }
 
-        std::sort(scored.begin(), scored.begin() + n,
+        std::sort(scored, scored + n,
             [](const ScoredMove& a, const ScoredMove& b) {
                 return a.score > b.score;
             });
@@ -57,4 +96,11 @@ namespace bq {
             first[i] = scored[i].move;
     }
 
+    template <Color Us>
+    inline void orderMoves(MoveList<Us>& moves, Move ttMove = Move{}, const HistoryTable* history = nullptr)
+    {
+        std::array<ScoredMove, 218> scored;
+        orderMoves<Us>(moves.begin(), moves.end(), scored.data(), ttMove, history);
+    }
+
 } // namespace bq
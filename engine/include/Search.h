@@ -4,22 +4,21 @@
 #include "Evaluation.h"
 #include "TranspositionTable.h"
 #include "MoveOrdering.h"
+#include "SearchStack.h"
+#include "CorrectionHistory.h"
 
 #include <array>
 #include <chrono>
 #include <atomic>
 #include <algorithm>
+#include <cmath>
 #include <cstdlib> // std::abs(int)
+#include <functional>
+#include <limits>
+#include <thread>
+#include <vector>
 namespace bq {
 
-	struct PVLine {
-		static constexpr int MAX = 64;
-		std::array<Move, MAX> m{};
-		int len = 0;
-
-		void clear() { len = 0; }
-	};
-
 	struct SearchStats {
 		int qDepthReached = 0;
 		long long ellapsedTime = 0;
@@ -29,6 +28,12 @@ namespace bq {
 		bool mateFound = false;
 		Move selectedMove;
 
+		long long aspirationResearches = 0; // root searches repeated after failing outside the aspiration window
+		long long ttCutoffs = 0;            // nodes answered from a hash table bound
+		long long singularSearches = 0;     // hash moves tested for singularity with a verification search
+		long long multiCuts = 0;            // nodes cut because the verification search failed high without the hash move
+		long long iirReductions = 0;        // nodes searched a ply shallower for want of a hash move
+
 		static constexpr int MAX_PV = 64;
 		std::array<Move, MAX_PV> pv{};
 		int pvLen = 0;
@@ -43,9 +48,37 @@ namespace bq {
 			mateFound = false;
 			selectedMove = Move{};
 			pvLen = 0;
+			aspirationResearches = 0;
+			ttCutoffs = 0;
+			singularSearches = 0;
+			multiCuts = 0;
+			iirReductions = 0;
 		}
 	};
 
+	// One legal move at the root with what the latest root search learned about it
+	struct RootMove {
+		static constexpr int NONE = std::numeric_limits<int>::min(); // not searched, or failed low
+
+		Move move;
+		int score = NONE;
+		int previousScore = NONE; // score from the previous iteration
+		long long nodes = 0;
+		std::array<Move, SearchStats::MAX_PV> pv{};
+		int pvLen = 0;
+	};
+
+	// Limits for one search; the defaults never expire and search every root move
+	struct SearchLimits {
+		using Clock = std::chrono::steady_clock;
+
+		Clock::time_point softDeadline = Clock::time_point::max(); // target; scaled by how settled the search looks
+		Clock::time_point hardDeadline = Clock::time_point::max(); // the running iteration is abandoned past this
+		std::vector<Move> searchMoves;                              // when not empty, only these root moves are searched
+		long long nodes = 0;                                        // exact node budget; 0 for none
+		int mate = 0;                                               // stop once a mate in this many moves is found; 0 for none
+	};
+
 	constexpr int pieceValues[NPIECE_TYPES] = {
 		100,
 		300,
@@ -58,90 +91,242 @@ namespace bq {
 	class Search {
 
 		bq::TranspositionTable m_transpositionTable;
+		bq::HistoryTable m_history;
+		bq::CorrectionHistory m_correction;
 		SearchStats m_searchStats;
 		std::atomic<bool> m_stopping{ false };
+		bool m_stopped = false;
+		SearchLimits m_limits;
+		SearchLimits::Clock::time_point m_searchStart;
+		long long m_nodeLimit = std::numeric_limits<long long>::max();
+
+		// Set by the caller before a ponder search and cleared on ponderhit. While it is set the deadlines
+		// are ignored; m_ponderSearch notices the ponderhit and restarts the clock from there.
+		std::atomic<bool> m_pondering{ false };
+		bool m_ponderSearch = false;
+
+		// Root moves in search order; resorted by score, then subtree size, after every iteration
+		std::vector<RootMove> m_rootMoves;
+		long long m_iterationNodes = 0;
+
+		// MultiPV: line <m_pvIdx> is searched over the root moves from m_pvIdx on, the better lines being fixed
+		int m_multiPv = 1;
+		int m_pvIdx = 0;
 		int m_maxSelDepth;
-		const int m_checkmateScore = 100000;
+		const int m_checkmateScore = CHECKMATE_SCORE;
 
-	public:
+		// Limits and the stop flag are polled once per this many nodes (power of two)
+		static constexpr long long STOP_CHECK_NODES = 1024;
 
-		Search(int maxSelDepth)
-			: m_maxSelDepth(maxSelDepth)
-		{
-		}
+		// Triangular PV table: row <ply> holds the best line found from that ply, built up as alpha improves
+		static constexpr int MAX_PLY = SearchStats::MAX_PV;
+		std::array<std::array<Move, MAX_PLY>, MAX_PLY> m_pvTable{};
+		std::array<int, MAX_PLY> m_pvLength{};
 
-		void signalStop() { m_stopping.store(true, std::memory_order_relaxed); }
+		// Per-ply move buffers and search state; quiescence can run m_maxSelDepth plies past MAX_PLY
+		SearchStack m_stack;
 
-		static bool isLegalRt(Position& p, Color stm, Move m) {
-			if (stm == WHITE) {
-				MoveList<WHITE> ml(p);
-				for (Move x : ml) if (x == m) return true;
-			}
-			else {
-				MoveList<BLACK> ml(p);
-				for (Move x : ml) if (x == m) return true;
-			}
-			return false;
-		}
+		// Nodes without a hash move are reduced by one ply from this depth on
+		static constexpr int IIR_MIN_DEPTH = 4;
 
-		static void playRt(Position& p, Color stm, Move m) {
-			if (stm == WHITE) p.play<WHITE>(m);
-			else              p.play<BLACK>(m);
-		}
+		// Null move pruning from this depth on; the null move search is reduced by at least NMP_BASE_REDUCTION + 1
+		static constexpr int NMP_MIN_DEPTH = 3;
+		static constexpr int NMP_BASE_REDUCTION = 3;
 
-		template <Color RootUs>
-		PVLine extractPvFromTt(Position& root, int maxPlies) {
-			PVLine out;
-			out.clear();
+		// ProbCut: non-PV nodes from this depth on try captures against beta + margin, searched this much shallower
+		static constexpr int PROBCUT_MIN_DEPTH = 5;
+		static constexpr int PROBCUT_MARGIN = 200;
+		static constexpr int PROBCUT_REDUCTION = 4;
 
-			Position tmp = root;
-			Color stm = RootUs;
+		// Hash moves are tested for singularity from this depth on
+		static constexpr int SINGULAR_MIN_DEPTH = 8;
 
-			// repetition / cycle guard
-			std::array<std::uint64_t, PVLine::MAX + 1> seen{};
-			int seenLen = 0;
+		// Depth of the running iteration; bounds the extensions along a line
+		int m_rootDepth = 0;
 
-			for (int ply = 0; ply < maxPlies && out.len < PVLine::MAX; ++ply) {
-				const std::uint64_t h = tmp.get_hash();
+		// Late move reductions indexed by [depth][moveNumber], grows with log(depth) * log(moveNumber)
+		static constexpr int LMR_MAX = 64;
+		inline static const std::array<std::array<int, LMR_MAX>, LMR_MAX> s_reductions = [] {
+			std::array<std::array<int, LMR_MAX>, LMR_MAX> r{};
+			for (int d = 1; d < LMR_MAX; ++d)
+				for (int m = 1; m < LMR_MAX; ++m)
+					r[d][m] = int(0.75 + std::log(double(d)) * std::log(double(m)) / 2.25);
+			return r;
+		}();
 
-				// break on repetition/cycle
-				for (int i = 0; i < seenLen; ++i) {
-					if (seen[i] == h) return out;
-				}
-				seen[seenLen++] = h;
+	public:
 
-				auto e = m_transpositionTable.lookup(h);
-				if (!e.valid || e.bestMove.is_null()) break;
+		// Mate in n plies scores CHECKMATE_SCORE - n
+		static constexpr int CHECKMATE_SCORE = 100000;
 
-				Move m = e.bestMove;
-				if (!isLegalRt(tmp, stm, m)) break;
+		// Called after every completed iteration with the first <lines> root moves as the reported lines
+		using InfoCallback = std::function<void(const SearchStats& stats, const std::vector<RootMove>& rootMoves, int lines)>;
 
-				out.m[out.len++] = m;
-				playRt(tmp, stm, m);
-				stm = ~stm;
-			}
+		Search(int maxSelDepth)
+			: m_maxSelDepth(maxSelDepth), m_stack(MAX_PLY + maxSelDepth + 1)
+		{
+		}
+
+		// With a transposition table of hashMb megabytes instead of the default size
+		Search(int maxSelDepth, std::size_t hashMb)
+			: m_transpositionTable(hashMb), m_maxSelDepth(maxSelDepth), m_stack(MAX_PLY + maxSelDepth + 1)
+		{
+		}
+
+		void signalStop() { m_stopping.store(true, std::memory_order_relaxed); }
+		// Clears a stop left over from the last search. Must be called before the search is handed to its thread,
+		// not from inside it, or a stop that arrives before the search starts is lost
+		void clearStop() { m_stopping.store(false, std::memory_order_relaxed); }
+
+		// Must be called before the search starts so an early ponderhit is not lost
+		void setPondering(bool pondering) { m_pondering.store(pondering, std::memory_order_relaxed); }
+		void ponderhit() { m_pondering.store(false, std::memory_order_relaxed); }
+		bool pondering() const { return m_pondering.load(std::memory_order_relaxed); }
+
+		void setMultiPv(int lines) { m_multiPv = std::max(1, lines); }
+		void setInfoCallback(InfoCallback cb) { m_infoCallback = std::move(cb); }
 
-			return out;
+		// Root moves of the last search, best first
+		const std::vector<RootMove>& rootMoves() const { return m_rootMoves; }
+
+		// Per-ply search state as the last search left it
+		const SearchStack& stack() const { return m_stack; }
+
+		// Forget everything learned from previous searches (hash table and move ordering statistics)
+		void clear() {
+			m_transpositionTable.clear();
+			m_history.clear();
+			m_correction.clear();
 		}
 
 		template <Color us>
-		SearchStats initiateIterativeSearch(Position& p, int depth) 
+		SearchStats initiateIterativeSearch(Position& p, int depth, const SearchLimits& limits = {}) 
 		{
 			m_searchStats.reset();
-			m_stopping = false;
+			m_stopped = false;
+			m_limits = limits;
+			m_nodeLimit = (limits.nodes > 0) ? limits.nodes : std::numeric_limits<long long>::max();
+			m_history.age();
+			m_stack.clearKillers();
+
+			MoveList<us> rootList(p);
+			const auto rootEntry = m_transpositionTable.lookup(p.get_hash());
+			orderMoves<us>(rootList, rootEntry.valid ? rootEntry.bestMove : Move{}, &m_history);
+			m_rootMoves.clear();
+			for (const Move& m : rootList) {
+				const auto& only = m_limits.searchMoves;
+				if (only.empty() || std::find(only.begin(), only.end(), m) != only.end())
+					m_rootMoves.push_back(RootMove{ m });
+			}
+
+			// None of the requested moves is legal here; search everything rather than nothing
+			if (m_rootMoves.empty())
+				for (const Move& m : rootList)
+					m_rootMoves.push_back(RootMove{ m });
+
+			m_searchStart = SearchLimits::Clock::now();
+			m_ponderSearch = m_pondering.load(std::memory_order_relaxed);
+			const bool timed = m_limits.softDeadline != SearchLimits::Clock::time_point::max();
+			Move prevBest{};
+			int prevScore = 0;
+			int stableIterations = 0;
 
 			for (int i = 1; i <= depth; ++i)
 			{
+				const auto iterationStart = SearchLimits::Clock::now();
 				initiateSearch<us>(p, i);
-				if (m_stopping.load(std::memory_order_relaxed)) break;
+				if (m_stopped) {
+					// A root move that beat alpha in the interrupted iteration is better than the last completed result.
+					// Past the first line of a MultiPV iteration the best line is already complete and reported.
+					const bool firstLine = m_pvIdx == 0;
+					m_pvIdx = 0;
+					if (!firstLine) break;
+
+					sortRootMoves(0);
+					if (m_rootMoves.empty() || m_rootMoves.front().score == RootMove::NONE) break;
+					m_searchStats.score = m_rootMoves.front().score;
+					takeBestRootMove();
+					break;
+				}
+
+				if (m_limits.mate > 0 && m_searchStats.score >= CHECKMATE_SCORE - (2 * m_limits.mate - 1))
+					break;
+				if (!timed) continue;
+
+				stableIterations = (m_searchStats.selectedMove == prevBest) ? stableIterations + 1 : 0;
+				const int scoreDrop = (i > 1) ? prevScore - m_searchStats.score : 0;
+				prevBest = m_searchStats.selectedMove;
+				prevScore = m_searchStats.score;
+
+				if (waitingForPonderhit()) continue;
+
+				// The next iteration costs at least about twice this one; don't start it if the hard deadline would cut it off
+				const auto now = SearchLimits::Clock::now();
+				if (now >= scaledSoftDeadline(m_searchStart, stableIterations, scoreDrop)
+					|| now + 2 * (now - iterationStart) >= m_limits.hardDeadline)
+					break;
 			}
+
+			// A bestmove may not be sent while pondering, even when the search has nothing left to do
+			while (!m_stopped && waitingForPonderhit() && !m_stopping.load(std::memory_order_relaxed))
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
 			return m_searchStats;
 		}
 
 	private:
 
+		InfoCallback m_infoCallback;
+
+		// Soft deadline stretched while the best move keeps changing, the score is falling, or the best move
+		// took only a small share of the nodes; shrunk when the search has settled. Never past the hard deadline.
+		SearchLimits::Clock::time_point scaledSoftDeadline(SearchLimits::Clock::time_point start, int stableIterations, int scoreDrop) const
+		{
+			const double stability = 1.4 - 0.1 * std::min(stableIterations, 6);
+			const double falling = 1.0 + std::clamp(scoreDrop, 0, 200) / 400.0;
+			const double bestShare = (m_iterationNodes > 0 && !m_rootMoves.empty())
+				? double(m_rootMoves.front().nodes) / double(m_iterationNodes) : 1.0;
+			const double effort = (1.5 - bestShare) * 1.2;
+
+			const auto soft = std::chrono::duration_cast<std::chrono::microseconds>(m_limits.softDeadline - start);
+			const auto scaled = start + std::chrono::microseconds((long long)(soft.count() * stability * falling * effort));
+			return std::min(scaled, m_limits.hardDeadline);
+		}
+
 		template <Color us>
 		void initiateSearch(Position& p, int depth)
+		{
+			m_rootDepth = depth;
+			for (RootMove& rm : m_rootMoves)
+				rm.previousScore = rm.score;
+
+			const int lines = std::max(1, std::min(m_multiPv, int(m_rootMoves.size())));
+
+			for (m_pvIdx = 0; m_pvIdx < lines; ++m_pvIdx)
+			{
+				searchLine<us>(p, depth);
+				if (m_stopped)
+					return;
+			}
+			m_pvIdx = 0;
+
+			// Lines come from separate searches; an unstable later line can outscore an earlier one
+			if (lines > 1) {
+				std::stable_sort(m_rootMoves.begin(), m_rootMoves.begin() + lines, [](const RootMove& a, const RootMove& b) {
+					return a.score > b.score;
+				});
+				if (m_rootMoves.front().score != RootMove::NONE)
+					m_searchStats.score = m_rootMoves.front().score;
+				takeBestRootMove();
+			}
+
+			if (m_infoCallback)
+				m_infoCallback(m_searchStats, m_rootMoves, lines);
+		}
+
+		// Aspiration search of line m_pvIdx; the first line also updates the reported result
+		template <Color us>
+		void searchLine(Position& p, int depth)
 		{
 			// Aspiration tuning knobs
 			constexpr int ASP_START = 35;     // centipawns-ish
@@ -152,10 +337,11 @@ namespace bq {
 			const int INF = m_checkmateScore;
 
 			// Use previous iteration score as the center (only if meaningful)
-			const int prevScore = m_searchStats.score;
+			const int prevScore = (m_pvIdx == 0) ? m_searchStats.score : m_rootMoves[m_pvIdx].previousScore;
 
 			bool useAsp =
 				(depth >= 2) &&
+				(prevScore != RootMove::NONE) &&
 				(std::abs(prevScore) < INF - MATE_GUARD);
 
 			int alpha = -INF;
@@ -175,22 +361,28 @@ namespace bq {
 			for (int attempt = 0; attempt < (useAsp ? ASP_TRIES : 1); ++attempt)
 			{
 				const auto start = std::chrono::steady_clock::now();
+				const long long nodesBefore = m_searchStats.nodesSearched;
 
-				score = pvs<us>(p, 0, depth, alpha, beta, false);
+				score = pvs<us, NodeType::Root>(p, 0, depth, alpha, beta);
+				if (m_pvIdx == 0)
+					m_iterationNodes = m_searchStats.nodesSearched - nodesBefore;
 
 				const auto stop = std::chrono::steady_clock::now();
 				const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
 				m_searchStats.ellapsedTime += duration.count();
 
-				if (m_stopping.load(std::memory_order_relaxed))
+				if (m_stopped)
 					return;
 
 				if (!useAsp)
 					break;
 
-				// Fail-low / fail-high: widen and retry
+				// Fail-low / fail-high: widen and retry. The fail-soft score says how far outside the window
+				// the result lies, so the new window is placed around it rather than around the old center.
 				if (score <= alpha || score >= beta)
 				{
+					++m_searchStats.aspirationResearches;
+					const bool failLow = score <= alpha;
 					delta *= ASP_GROW;
 
 					// If we've basically widened to "infinite", just do full window once
@@ -202,8 +394,12 @@ namespace bq {
 						continue;
 					}
 
-					alpha = std::max(-INF, center - delta);
-					beta = std::min(+INF, center + delta);
+					if (failLow) {
+						beta = (alpha + beta) / 2;
+						alpha = std::max(-INF, std::min(score, center) - delta);
+					}
+					else
+						beta = std::min(+INF, std::max(score, center) + delta);
 					continue;
 				}
 
@@ -214,64 +410,85 @@ namespace bq {
 			// If we fell back to full window, run it once (when useAsp was disabled by widening)
 			if (!useAsp && (alpha != -INF || beta != +INF)) {
 				const auto start = std::chrono::steady_clock::now();
-				score = pvs<us>(p, 0, depth, -INF, +INF, false);
+				const long long nodesBefore = m_searchStats.nodesSearched;
+				score = pvs<us, NodeType::Root>(p, 0, depth, -INF, +INF);
+				if (m_pvIdx == 0)
+					m_iterationNodes = m_searchStats.nodesSearched - nodesBefore;
 				const auto stop = std::chrono::steady_clock::now();
 				const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
 				m_searchStats.ellapsedTime += duration.count();
 
-				if (m_stopping.load(std::memory_order_relaxed))
+				if (m_stopped)
 					return;
 			}
 
-			// PV from TT (as you already do)
-			PVLine pv = extractPvFromTt<us>(p, depth);
+			sortRootMoves(m_pvIdx);
+			if (m_pvIdx > 0)
+				return;
 
 			m_searchStats.depth = depth;
 			m_searchStats.score = score;
 
-			m_searchStats.pvLen = pv.len;
-			for (int i = 0; i < pv.len; ++i)
-				m_searchStats.pv[i] = pv.m[i];
-
-			m_searchStats.selectedMove = (pv.len > 0) ? pv.m[0] : Move{};
+			takeBestRootMove();
 			m_searchStats.mateFound = (std::abs(score) >= INF - 256);
 		}
 
+		void sortRootMoves(int from) {
+			std::stable_sort(m_rootMoves.begin() + from, m_rootMoves.end(), [](const RootMove& a, const RootMove& b) {
+				return (a.score != b.score) ? a.score > b.score : a.nodes > b.nodes;
+			});
+		}
+
+		// Reports the front root move; a root fail-low leaves no line behind, so the previous PV is kept then
+		void takeBestRootMove() {
+			if (!m_rootMoves.empty() && m_rootMoves.front().score != RootMove::NONE) {
+				const RootMove& best = m_rootMoves.front();
+				m_searchStats.pvLen = best.pvLen;
+				for (int i = 0; i < best.pvLen; ++i)
+					m_searchStats.pv[i] = best.pv[i];
+			}
+
+			m_searchStats.selectedMove = (m_searchStats.pvLen > 0) ? m_searchStats.pv[0] : Move{};
+		}
+
 
 		template <Color us>
 		int quiescence(Position& p, int ply, int q_depth, int alpha, int beta) 
 		{
 			auto& stats = m_searchStats;
-			++stats.nodesSearched;
-
-			if (m_stopping.load(std::memory_order_relaxed))
+			if (!enterNode())
 				return alpha;
 
 			if (q_depth > stats.qDepthReached)
 				stats.qDepthReached = q_depth;
 
-			const int stand_pat = bq::Evaluation::ScoreBoard<us>(p);
+			// Fail-soft: the best score found is returned even when it lies outside the window
+			const int stand_pat = m_correction.correct(us, p.get_pawn_hash(), bq::Evaluation::ScoreBoard<us>(p));
 
 			if (stand_pat >= beta)
-				return beta;
+				return stand_pat;
 
+			int bestScore = stand_pat;
 			if (stand_pat > alpha)
 				alpha = stand_pat;
 
 			if (q_depth >= m_maxSelDepth)
-				return alpha;
+				return bestScore;
 
 			const bool inCheck = p.in_check<us>();
 
+			StackEntry& ss = m_stack[ply];
+
 			// In check: must consider all evasions (quiet king moves, blocks, etc.)
 			if (inCheck) {
-				MoveList<us> moves(p);
+				Move* const last = p.generate_legals<us, false>(ss.moves.data());
 
-				if (moves.size() == 0)
+				if (last == ss.moves.data())
 					return -m_checkmateScore + ply;
 
-				for (const Move move : moves)
+				for (const Move* it = ss.moves.data(); it != last; ++it)
 				{
+					const Move move = *it;
 					p.play<us>(move);
 
 					const int score = -quiescence<~us>(
@@ -285,33 +502,43 @@ namespace bq {
 					p.undo<us>(move);
 
 					if (score >= beta)
-						return beta;
+						return score;
 
-					if (score > alpha)
-						alpha = score;
+					if (score > bestScore) {
+						bestScore = score;
+						alpha = std::max(alpha, score);
+					}
 				}
 
-				return alpha;
+				return bestScore;
 			}
 
-			// Not in check: only generate tacticals (captures, promotions, ep)
-			TacticalMoveList<us> moves(p);
-
-			// Not in check and no tacticals: stand-pat result already in alpha
-			if (moves.size() == 0)
-				return alpha;
+			// Not in check: only generate tacticals (captures, promotions, ep), plus quiet checks on the first
+			// qsearch ply so mating attacks just past the horizon are seen. Deeper plies stay captures only.
+			Move* last = p.generate_legals<us, true>(ss.moves.data());
+			if (q_depth == 0)
+				last = p.generate_quiet_checks<us>(last);
 
-			for (const Move move : moves)
+			for (const Move* it = ss.moves.data(); it != last; ++it)
 			{
+				const Move move = *it;
 				// Optional (same logic you already had): cheap delta pruning for captures
 				if (move.is_capture()) {
 					const Piece victim = p.at(move.to());
 					if (victim != NO_PIECE) {
 						const int gain = pieceValues[type_of(victim)];
-						if (stand_pat + gain + 100 < alpha)
+						const int futility = stand_pat + gain + 100;
+						if (futility < alpha) {
+							// The capture could have scored at most this much
+							bestScore = std::max(bestScore, futility);
 							continue;
+						}
 					}
 				}
+				// A quiet check that hangs the piece is left to the main search
+				else if (!move.is_promotion() && !p.see_ge(move, 0)) {
+					continue;
+				}
 
 				p.play<us>(move);
 
@@ -326,40 +553,134 @@ namespace bq {
 				p.undo<us>(move);
 
 				if (score >= beta)
-					return beta;
+					return score;
 
-				if (score > alpha)
-					alpha = score;
+				if (score > bestScore) {
+					bestScore = score;
+					alpha = std::max(alpha, score);
+				}
 			}
 
-			return alpha;
+			return bestScore;
 		}
 
 
+		// Checkmate takes precedence over the fifty-move rule: the draw counts only if the side to move is not mated
+		template <Color us>
+		static bool isFiftyMoveDraw(Position& p) {
+			if (!p.is_fifty_move_draw())
+				return false;
+			if (!p.in_check<us>())
+				return true;
+			MoveList<us> moves(p);
+			return moves.size() > 0;
+		}
+
 		template <Color us>
-		int pvs(Position& p, int ply, int depth, int alpha, int beta, bool reduced) 
+		static bool hasPieces(const Position& p) {
+			return (p.bitboard_of(us, KNIGHT) | p.bitboard_of(us, BISHOP) | p.bitboard_of(us, ROOK) | p.bitboard_of(us, QUEEN)) != 0;
+		}
+
+		void updatePv(int ply, Move move) {
+			auto& line = m_pvTable[ply];
+			const int childLen = m_pvLength[ply + 1];
+
+			line[0] = move;
+			for (int i = 0; i < childLen; ++i)
+				line[i + 1] = m_pvTable[ply + 1][i];
+			m_pvLength[ply] = childLen + 1;
+		}
+
+		// Counts a node unless the search is stopping. The node budget is checked on every node so it is met exactly.
+		bool enterNode() {
+			if (m_stopped)
+				return false;
+			if (m_searchStats.nodesSearched >= m_nodeLimit) {
+				m_stopped = true;
+				return false;
+			}
+
+			++m_searchStats.nodesSearched;
+			pollStop();
+			return !m_stopped;
+		}
+
+		// Sets m_stopped once the hard deadline passes or a stop was signalled; only looked at every STOP_CHECK_NODES nodes
+		void pollStop() {
+			if ((m_searchStats.nodesSearched & (STOP_CHECK_NODES - 1)) != 0)
+				return;
+
+			if (m_stopping.load(std::memory_order_relaxed)) {
+				m_stopped = true;
+				return;
+			}
+
+			if (!waitingForPonderhit() && SearchLimits::Clock::now() >= m_limits.hardDeadline)
+				m_stopped = true;
+		}
+
+		// True while a ponder search has not had its ponderhit yet. The first call after the ponderhit shifts
+		// the deadlines by the time spent pondering, so the budget counts from the ponderhit.
+		bool waitingForPonderhit() {
+			if (!m_ponderSearch)
+				return false;
+			if (m_pondering.load(std::memory_order_relaxed))
+				return true;
+
+			const auto now = SearchLimits::Clock::now();
+			const auto pondered = now - m_searchStart;
+			if (m_limits.softDeadline != SearchLimits::Clock::time_point::max()) m_limits.softDeadline += pondered;
+			if (m_limits.hardDeadline != SearchLimits::Clock::time_point::max()) m_limits.hardDeadline += pondered;
+			m_searchStart = now;
+			m_ponderSearch = false;
+			return false;
+		}
+
+		// Root: ply 0, searches the root move list. PV: open window, keeps a PV. NonPV: zero window.
+		enum class NodeType { Root, PV, NonPV };
+
+		template <Color us, NodeType nodeType>
+		int pvs(Position& p, int ply, int depth, int alpha, int beta) 
 		{
+			constexpr bool rootNode = nodeType == NodeType::Root;
+			constexpr bool pvNode = nodeType != NodeType::NonPV;
+
 			auto& stats = m_searchStats;
-			stats.nodesSearched++;
-			if (m_stopping.load(std::memory_order_relaxed)) {
+			m_pvLength[ply] = 0;
+
+			if (!enterNode()) {
 				return alpha;
 			}
 
-			
+			if (ply >= MAX_PLY - 1)
+				return bq::Evaluation::ScoreBoard<us>(p);
+
+			// Draws are scored immediately and never stored in the TT
+			if (!rootNode && (isFiftyMoveDraw<us>(p) || p.is_repetition(ply)))
+				return 0;
+
+			// If the side to move can repeat a position from earlier in the tree, a draw is the least it can get
+			if (!rootNode && alpha < 0 && p.has_game_cycle(ply)) {
+				alpha = 0;
+				if (alpha >= beta)
+					return alpha;
+			}
 
 			if (depth <= 0)
 				return quiescence<us>(p, ply, 0, alpha, beta);
 
 
-			const int orig_alpha = alpha;
-			const int orig_beta = beta;
+			StackEntry& ss = m_stack[ply];
 
+			// Set while verifying that the hash move is singular: that move is skipped and nothing is stored
+			const Move excluded = ss.excludedMove;
 
 			const std::uint64_t key = p.get_hash();
 
 			auto tt_lookup = m_transpositionTable.lookup(key);
 
-			if (tt_lookup.valid && tt_lookup.depth >= depth)
+			// No hash cutoff at the root so the reported line always comes from this search
+			if (!rootNode && excluded.is_null() && tt_lookup.valid && tt_lookup.depth >= depth)
 			{
 				int tt_score = tt_lookup.score;
 
@@ -371,83 +692,281 @@ namespace bq {
 						: tt_score + ply;
 				}
 
-				if (tt_lookup.flag == tt_flag::EXACT)
+				// A bound that settles the node returns the stored score as it is; otherwise it narrows the window
+				if (tt_lookup.flag == tt_flag::EXACT
+					|| (tt_lookup.flag == tt_flag::LOWERBOUND && tt_score >= beta)
+					|| (tt_lookup.flag == tt_flag::UPPERBOUND && tt_score <= alpha)) {
+					++stats.ttCutoffs;
 					return tt_score;
-
+				}
 				if (tt_lookup.flag == tt_flag::LOWERBOUND)
 					alpha = std::max(alpha, tt_score);
 				else if (tt_lookup.flag == tt_flag::UPPERBOUND)
 					beta = std::min(beta, tt_score);
+			}
 
-				if (alpha >= beta)
+			// The bound stored at the end is judged against the window left after the hash bounds
+			const int orig_alpha = alpha;
+			const int orig_beta = beta;
+
+			const bool usInCheck = p.in_check<us>();
+
+			// Static eval, kept on the stack for the pruning decisions below and for "improving" two plies on.
+			// A singular verification search keeps the eval of the node it belongs to; in check there is none.
+			// The eval is corrected by what earlier searches found in positions with the same pawns.
+			if (usInCheck)
+				ss.staticEval = StackEntry::NO_EVAL;
+			else if (excluded.is_null())
+				ss.staticEval = m_correction.correct(us, p.get_pawn_hash(), bq::Evaluation::ScoreBoard<us>(p));
+			const int staticEval = ss.staticEval;
+
+			// Improving: the eval is higher than at this side's previous move (or the one before, if that was in check).
+			// Pruning is more careful and reductions are smaller while it isn't.
+			bool improving = false;
+			if (staticEval != StackEntry::NO_EVAL) {
+				const int prev2 = (ply >= 2) ? m_stack[ply - 2].staticEval : StackEntry::NO_EVAL;
+				const int prev4 = (ply >= 4) ? m_stack[ply - 4].staticEval : StackEntry::NO_EVAL;
+				improving = (prev2 != StackEntry::NO_EVAL) ? staticEval > prev2
+					: (prev4 != StackEntry::NO_EVAL) ? staticEval > prev4
+					: true;
+			}
+
+			// Shallow-depth quiet move pruning knobs
+			constexpr int FUTILITY_DEPTH = 3;
+			constexpr int FUTILITY_BASE = 100;
+			constexpr int FUTILITY_PER_DEPTH = 120;
+			constexpr int LMP_BASE = 3;           // quiets searched before pruning: LMP_BASE + depth^2
+			constexpr int HISTORY_PRUNE_DEPTH = 2;
+			constexpr int HISTORY_PRUNE = 1'024;  // per ply of depth
+
+			// Internal iterative reduction: without a hash move the ordering is poor and the node is likely new, so it is
+			// searched a ply shallower; the next iteration finds the move this search stores.
+			if (!rootNode && excluded.is_null() && depth >= IIR_MIN_DEPTH && (!tt_lookup.valid || tt_lookup.bestMove.is_null())) {
+				++stats.iirReductions;
+				--depth;
+			}
+
+			const Move ttMove = (tt_lookup.valid ? tt_lookup.bestMove : Move{});
+
+			// Singular extension: a hash move that beats every alternative by a margin is searched one ply deeper.
+			// The alternatives get a reduced zero-window search just below the hash score without the hash move.
+			bool ttMoveSingular = false;
+			if (!rootNode && excluded.is_null() && depth >= SINGULAR_MIN_DEPTH && !ttMove.is_null()
+				&& tt_lookup.depth >= depth - 3 && tt_lookup.flag != tt_flag::UPPERBOUND
+				&& std::abs(tt_lookup.score) < m_checkmateScore - 1000)
+			{
+				const int singularBeta = tt_lookup.score - 2 * depth;
+
+				++stats.singularSearches;
+				ss.excludedMove = ttMove;
+				const int score = pvs<us, NodeType::NonPV>(p, ply, (depth - 1) / 2, singularBeta - 1, singularBeta);
+				ss.excludedMove = Move{};
+
+				if (m_stopped)
 					return alpha;
+
+				if (score < singularBeta)
+					ttMoveSingular = true;
+				// Multi-cut: even without the hash move this node fails high
+				else if (!pvNode && singularBeta >= beta) {
+					++stats.multiCuts;
+					return singularBeta;
+				}
 			}
-			const bool usInCheck = p.in_check<us>();
-			const bool pvNode = (beta - alpha) > 1;
 
-			if (!pvNode && depth <= 2 && !usInCheck) {
-				int eval = bq::Evaluation::ScoreBoard<us>(p);
+			const bool canPruneQuiets = !pvNode && !usInCheck && depth <= FUTILITY_DEPTH;
 
-				if (eval + 220 * depth <= alpha) {
+			if (canPruneQuiets && depth <= 2) {
+				if (staticEval + 220 * depth <= alpha) {
 					return quiescence<us>(p, ply, 0, alpha, beta);
 				}
 
-				if (eval - 150 * depth >= beta) {
-					return beta;
+				if (staticEval - 150 * std::max(1, depth - improving) >= beta) {
+					return staticEval;
 				}
 			}
 
-			MoveList<us> moves(p);
-			const Move ttMove = (tt_lookup.valid ? tt_lookup.bestMove : Move{});
-			orderMoves<us>(moves,ttMove);
+			// Null move pruning: if handing the opponent a free move still fails high in a reduced search, a real move
+			// would too. Not twice in a row, and not with only pawns left, where passing may be the best move.
+			if (!pvNode && !usInCheck && excluded.is_null() && depth >= NMP_MIN_DEPTH && staticEval >= beta
+				&& ply > 0 && !m_stack[ply - 1].currentMove.is_null() && hasPieces<us>(p)
+				&& std::abs(beta) < m_checkmateScore - 1000)
+			{
+				const int r = NMP_BASE_REDUCTION + depth / 4 + (improving ? 1 : 0);
+
+				ss.currentMove = Move{};
+				m_stack[ply + 1].extensions = ss.extensions;
+				p.play_null();
+				const int score = -pvs<~us, NodeType::NonPV>(p, ply + 1, depth - 1 - r, -beta, -beta + 1);
+				p.undo_null();
+
+				if (m_stopped)
+					return alpha;
 
-			if (moves.size() == 0)
+				// An unproven mate from a null move search isn't trusted
+				if (score >= beta)
+					return (score >= m_checkmateScore - 1000) ? beta : score;
+			}
+
+			// ProbCut: if a capture that doesn't lose material beats beta by a margin in a much shallower search, the full
+			// search would almost certainly fail high too. Skipped when the hash table already says it won't.
+			const int probCutBeta = beta + PROBCUT_MARGIN;
+			if (!pvNode && !usInCheck && excluded.is_null() && depth >= PROBCUT_MIN_DEPTH
+				&& std::abs(beta) < m_checkmateScore - 1000
+				&& !(tt_lookup.valid && tt_lookup.depth >= depth - 3 && tt_lookup.score < probCutBeta))
+			{
+				Move* const captures = ss.moves.data();
+				Move* const capturesEnd = p.generate_legals<us, true>(captures);
+
+				for (const Move* it = captures; it != capturesEnd; ++it)
+				{
+					const Move move = *it;
+					if (!p.see_ge(move, 0))
+						continue;
+
+					ss.currentMove = move;
+					p.play<us>(move);
+
+					// A quiescence search first weeds out the captures that don't even hold up there
+					int score = -quiescence<~us>(p, ply + 1, 0, -probCutBeta, -probCutBeta + 1);
+					if (score >= probCutBeta)
+						score = -pvs<~us, NodeType::NonPV>(p, ply + 1, depth - PROBCUT_REDUCTION, -probCutBeta, -probCutBeta + 1);
+
+					p.undo<us>(move);
+
+					if (m_stopped)
+						return alpha;
+
+					if (score >= probCutBeta) {
+						tt_entry e;
+						e.valid = true;
+						e.score = (std::abs(score) >= m_checkmateScore - 1000) ? (score > 0 ? score + ply : score - ply) : score;
+						e.depth = depth - PROBCUT_REDUCTION + 1;
+						e.flag = tt_flag::LOWERBOUND;
+						e.bestMove = move;
+						m_transpositionTable.insert(key, e);
+						return score;
+					}
+				}
+			}
+
+			Move* const moves = ss.moves.data();
+			Move* last = p.generate_legals<us, false>(moves);
+
+			orderMoves<us>(moves, last, ss.scores.data(), ttMove, &m_history, &ss.killers);
+
+			// The root searches the moves of the current line, the previous best first and the rest in normal move order
+			if (rootNode && !m_rootMoves.empty()) {
+				const auto first = m_rootMoves.begin() + m_pvIdx;
+				const auto rank = [&](Move m) { return std::find(moves, last, m) - moves; };
+				std::stable_sort(first + 1, m_rootMoves.end(), [&](const RootMove& a, const RootMove& b) {
+					return rank(a.move) < rank(b.move);
+				});
+
+				last = moves;
+				for (auto it = first; it != m_rootMoves.end(); ++it) {
+					it->score = RootMove::NONE;
+					it->nodes = 0;
+					*last++ = it->move;
+				}
+			}
+
+			if (last == moves)
 			{
 				if (usInCheck) return -m_checkmateScore + ply;
 				else                  return 0;
 			}
 
+			// A capture as the hash move means quiet alternatives are unlikely to matter
+			const bool ttMoveIsCapture = !ttMove.is_null() && ttMove.is_capture();
+
 			bool haveBest = false;
 			int bestScore = -m_checkmateScore - 1;
 			Move bestMove{};
-			
+
+			std::array<Move, 64> quietsTried;
+			int quietCount = 0;
+
+			// Extensions along one line share a budget so that long checking sequences can't blow up the tree
+			const bool canExtend = ss.extensions < std::max(1, m_rootDepth / 2);
+
 			int moveNum = 0;
-			for (Move& move : moves)
+			for (const Move* it = moves; it != last; ++it)
 			{
-				p.play<us>(move);
+				const Move move = *it;
+				if (move == excluded)
+					continue;
+
+				const bool isQuiet = !move.is_capture() && !move.is_promotion();
+				const long long nodesBefore = stats.nodesSearched;
+
+				const bool givesCheck = p.gives_check<us>(move);
+
+				// Skip quiets that can't plausibly raise alpha: futile by static eval, too late
+				// in the list, or with a poor history record. Checks are always searched.
+				if (canPruneQuiets && moveNum > 0 && isQuiet && !givesCheck) {
+					const bool futile = staticEval + FUTILITY_BASE + FUTILITY_PER_DEPTH * (depth + improving) <= alpha;
+					const bool lateMove = quietCount >= (LMP_BASE + depth * depth) / (improving ? 1 : 2);
+					const bool badHistory = depth <= HISTORY_PRUNE_DEPTH
+						&& m_history.get(us, move) < -HISTORY_PRUNE * depth;
+
+					if (futile || lateMove || badHistory) {
+						++moveNum;
+						continue;
+					}
+				}
 
-				int move_reduct = 0;
-				// const int moveCount = int(moves.size()); // if you need it
-				if (!pvNode && moveNum > 3 && depth >= 3 && !reduced && !move.is_capture())
-					move_reduct = 1;
+				ss.currentMove = move;
+				p.play<us>(move);
 
+				const int extension = (canExtend && (givesCheck || (ttMoveSingular && move == ttMove))) ? 1 : 0;
+				const int newDepth = depth - 1 + extension;
+				m_stack[ply + 1].extensions = ss.extensions + extension;
 
 				int score = 0;
 
-				if (moveNum == 0 || p.in_check<~us>())
+				if (moveNum == 0 || givesCheck)
 				{
-					score = -pvs<~us>(p, ply + 1, (depth - 1), -beta, -alpha, reduced);
+					// Hash bounds can close a PV node's window; its children are then searched as zero-window nodes
+					score = (pvNode && beta - alpha > 1)
+						? -pvs<~us, NodeType::PV>(p, ply + 1, newDepth, -beta, -alpha)
+						: -pvs<~us, NodeType::NonPV>(p, ply + 1, newDepth, -beta, -alpha);
 				}
 				else
 				{
-					score = -pvs<~us>(p, ply + 1, (depth - 1) - move_reduct,
-						-alpha - 1, -alpha, move_reduct > 0);
+					int r = 0;
+					if (depth >= 3 && isQuiet && moveNum >= (pvNode ? 3 : 2)) {
+						r = s_reductions[std::min(depth, LMR_MAX - 1)][std::min(moveNum, LMR_MAX - 1)];
+						if (pvNode) --r;
+						if (usInCheck) --r;
+						if (ttMoveIsCapture) ++r;
+						if (!improving) ++r;
+						r -= m_history.get(us, move) / 8'192;
+						r = std::clamp(r, 0, depth - 2);
+					}
+
+					score = -pvs<~us, NodeType::NonPV>(p, ply + 1, newDepth - r, -alpha - 1, -alpha);
 
-					if (score > alpha && move_reduct > 0) {
-						score = -pvs<~us>(p, ply + 1, depth - 1, -alpha - 1, -alpha, false);
+					if (score > alpha && r > 0) {
+						score = -pvs<~us, NodeType::NonPV>(p, ply + 1, newDepth, -alpha - 1, -alpha);
 					}
 
-					if (score > alpha && score < beta) {
-						score = -pvs<~us>(p, ply + 1, depth - 1, -beta, -alpha, false);
+					if constexpr (pvNode) {
+						if (score > alpha && score < beta) {
+							score = -pvs<~us, NodeType::PV>(p, ply + 1, newDepth, -beta, -alpha);
+						}
 					}
 				}
 
 				p.undo<us>(move);
 
-				if (m_stopping.load(std::memory_order_relaxed)) {
+				if (m_stopped) {
 					return alpha;
 				}
 
+				if constexpr (rootNode)
+					m_rootMoves[m_pvIdx + moveNum].nodes = stats.nodesSearched - nodesBefore;
+
 				if (!haveBest || score > bestScore) {
 					haveBest = true;
 					bestScore = score;
@@ -458,9 +977,30 @@ namespace bq {
 				{
 					alpha = score;
 					bestMove = move;
+					if constexpr (pvNode)
+						updatePv(ply, move);
+					if constexpr (rootNode) {
+						RootMove& rm = m_rootMoves[m_pvIdx + moveNum];
+						rm.score = score;
+						rm.pvLen = m_pvLength[0];
+						for (int i = 0; i < rm.pvLen; ++i)
+							rm.pv[i] = m_pvTable[0][i];
+					}
 				}
 
 				if (score >= beta) {
+					if (isQuiet) {
+						const int bonus = std::min(32 * depth * depth, 1'536);
+						m_history.update(us, move, bonus);
+						for (int i = 0; i < quietCount; ++i)
+							m_history.update(us, quietsTried[i], -bonus);
+
+						if (ss.killers[0] != move) {
+							ss.killers[1] = ss.killers[0];
+							ss.killers[0] = move;
+						}
+					}
+
 					tt_entry e;
 					e.valid = true;
 
@@ -473,19 +1013,29 @@ namespace bq {
 					e.flag = tt_flag::LOWERBOUND;
 					e.bestMove = move;
 
-					m_transpositionTable.insert(key, e);
+					if (excluded.is_null()) {
+						m_transpositionTable.insert(key, e);
+						updateCorrection<us>(p, depth, move, score, staticEval, tt_flag::LOWERBOUND);
+					}
 					return score;
 				}
 
+				if (isQuiet && quietCount < int(quietsTried.size()))
+					quietsTried[quietCount++] = move;
+
 				++moveNum;
 			}
 
+			// A verification search only reports how the alternatives score; with none of them it fails low
+			if (!excluded.is_null())
+				return haveBest ? bestScore : alpha;
+
 			tt_entry entry;
 			entry.valid = true;
 
 			entry.bestMove = haveBest ? bestMove : Move{};
 
-			int storeScore = alpha;
+			int storeScore = bestScore;
 			if (std::abs(storeScore) >= m_checkmateScore - 1000)
 			{
 				storeScore = (storeScore > 0)
@@ -496,12 +1046,26 @@ namespace bq {
 			entry.score = storeScore;
 			entry.depth = depth;
 
-			if (alpha <= orig_alpha) entry.flag = tt_flag::UPPERBOUND;
-			else if (alpha >= orig_beta) entry.flag = tt_flag::LOWERBOUND;
+			if (bestScore <= orig_alpha) entry.flag = tt_flag::UPPERBOUND;
+			else if (bestScore >= orig_beta) entry.flag = tt_flag::LOWERBOUND;
 			else entry.flag = tt_flag::EXACT;
 
 			m_transpositionTable.insert(key, entry);
-			return alpha;
+			updateCorrection<us>(p, depth, entry.bestMove, bestScore, staticEval, entry.flag);
+			return bestScore;
+		}
+
+		// Feeds the difference between a search result and the static eval into the correction history.
+		// Only quiet results count, and a bound only when it says the eval was wrong in its direction.
+		template<Color us>
+		inline void updateCorrection(const Position& p, int depth, Move bestMove, int score, int staticEval, tt_flag flag) {
+			if (staticEval == StackEntry::NO_EVAL || std::abs(score) >= m_checkmateScore - 1000)
+				return;
+			if (!bestMove.is_null() && (bestMove.is_capture() || bestMove.is_promotion()))
+				return;
+			if ((flag == tt_flag::LOWERBOUND && score <= staticEval) || (flag == tt_flag::UPPERBOUND && score >= staticEval))
+				return;
+			m_correction.update(us, p.get_pawn_hash(), depth, score, staticEval);
 		}
 	};
 }
\ No newline at end of file
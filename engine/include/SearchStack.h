@@ -0,0 +1,47 @@
+#pragma once
+#include <array>
+#include <limits>
+#include <vector>
+
+#include "surge.h"
+#include "MoveOrdering.h"
+
+namespace bq {
+
+    // Most legal moves any chess position can have
+    constexpr int MAX_MOVES = 218;
+
+    // Everything one ply of the search needs, so recursion indexes into a preallocated arena instead of
+    // building move arrays on the call stack. Small per-ply state sits in the first cache line.
+    struct alignas(64) StackEntry {
+        static constexpr int NO_EVAL = std::numeric_limits<int>::min(); // static eval while in check
+
+        Move currentMove;                 // move being searched from this ply
+        Move excludedMove;                // move left out of a verification search at this ply
+        std::array<Move, 2> killers{};    // quiet moves that caused a cutoff at this ply, newest first
+        int staticEval = NO_EVAL;
+        int extensions = 0;               // plies of extension used on the line from the root to here
+
+        std::array<Move, MAX_MOVES> moves;
+        std::array<ScoredMove, MAX_MOVES> scores;
+    };
+
+    // One per search thread, sized once for the deepest ply the search can reach
+    class SearchStack {
+    public:
+        explicit SearchStack(int plies) : m_entries(plies) {}
+
+        StackEntry& operator[](int ply) { return m_entries[ply]; }
+        const StackEntry& operator[](int ply) const { return m_entries[ply]; }
+        int size() const { return int(m_entries.size()); }
+
+        void clearKillers() {
+            for (StackEntry& e : m_entries)
+                e.killers = {};
+        }
+
+    private:
+        std::vector<StackEntry> m_entries;
+    };
+
+} // namespace bq
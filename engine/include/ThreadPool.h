@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bq {
+
+    // A long-lived thread that sleeps on a condition variable between searches.
+    // start() hands it one job; wait() blocks until that job has returned.
+    class SearchWorker {
+        std::mutex m_mx;
+        std::condition_variable m_cv;
+        std::function<void()> m_job;
+        bool m_busy = false;
+        bool m_exit = false;
+        std::thread m_thread;
+
+        void idleLoop() {
+            std::unique_lock<std::mutex> lk(m_mx);
+            while (true) {
+                m_cv.wait(lk, [&] { return m_busy || m_exit; });
+                if (m_exit) return;
+
+                std::function<void()> job = std::move(m_job);
+                lk.unlock();
+                job();
+                lk.lock();
+
+                m_busy = false;
+                m_cv.notify_all();
+            }
+        }
+
+    public:
+        SearchWorker() : m_thread([this] { idleLoop(); }) {}
+
+        ~SearchWorker() {
+            {
+                std::lock_guard<std::mutex> lk(m_mx);
+                m_exit = true;
+            }
+            m_cv.notify_all();
+            m_thread.join();
+        }
+
+        SearchWorker(const SearchWorker&) = delete;
+        SearchWorker& operator=(const SearchWorker&) = delete;
+
+        // Runs job on this worker; waits for a previous job first
+        void start(std::function<void()> job) {
+            std::unique_lock<std::mutex> lk(m_mx);
+            m_cv.wait(lk, [&] { return !m_busy; });
+            m_job = std::move(job);
+            m_busy = true;
+            m_cv.notify_all();
+        }
+
+        void wait() {
+            std::unique_lock<std::mutex> lk(m_mx);
+            m_cv.wait(lk, [&] { return !m_busy; });
+        }
+
+        bool busy() {
+            std::lock_guard<std::mutex> lk(m_mx);
+            return m_busy;
+        }
+    };
+
+    // Search threads, created once and only rebuilt when the thread count changes.
+    // Worker 0 drives the search; the rest are parked until work is shared between threads.
+    class ThreadPool {
+        std::vector<std::unique_ptr<SearchWorker>> m_workers;
+
+    public:
+        explicit ThreadPool(std::size_t n = 1) { resize(n); }
+
+        // Callers must make sure no job is running
+        void resize(std::size_t n) {
+            n = std::max<std::size_t>(1, n);
+            if (n == m_workers.size()) return;
+
+            m_workers.clear();
+            for (std::size_t i = 0; i < n; ++i)
+                m_workers.push_back(std::make_unique<SearchWorker>());
+        }
+
+        std::size_t size() const { return m_workers.size(); }
+
+        SearchWorker& main() { return *m_workers.front(); }
+        SearchWorker& operator[](std::size_t i) { return *m_workers[i]; }
+
+        void waitAll() {
+            for (auto& w : m_workers) w->wait();
+        }
+    };
+
+}
@@ -3,20 +3,24 @@
 
 #include <algorithm>
 #include <atomic>
+#include <charconv>
 #include <chrono>
 #include <cctype>
 #include <cstdint>
+#include <fstream>
 #include <functional>
 #include <iostream>
 #include <mutex>
 #include <optional>
 #include <sstream>
 #include <string>
-#include <thread>
 #include <vector>
 
 #include "surge.h"
 #include "ChessAi.h"
+#include "Evaluation.h"
+#include "MateSolver.h"
+#include "ThreadPool.h"
 
 namespace bq {
 
@@ -28,6 +32,9 @@ namespace bq {
             , m_ai(defaultColor)
             , m_pos(kStartposFen)
         {
+            m_ai.setInfoCallback([this](const SearchStats& s, const std::vector<RootMove>& roots, int lines) {
+                writeInfo(s, roots, lines);
+            });
         }
 
         ~UciClient() {
@@ -56,6 +63,25 @@ namespace bq {
         static constexpr const char* kStartposFen =
             "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
+        // Fixed position set for the "bench" command; node counts are deterministic for a given build
+        static constexpr int kBenchDepth = 8;
+        static constexpr std::size_t kBenchHashMb = 16;
+        static constexpr int kEvalBenchRounds = 10000;
+        static constexpr const char* kBenchFens[] = {
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+            "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+            "r3k2r/pppq1ppp/2npbn2/4p3/4P3/2NPBN2/PPPQ1PPP/R3K2R w KQkq - 0 1",
+            "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ - 0 8",
+            "r2q1rk1/1b1nbppp/p2ppn2/1p6/3NP3/1BN1BP2/PPPQ2PP/2KR3R w - - 0 12",
+            "2r3k1/pp3ppp/4p3/3pP3/3P4/P4N2/1P3PPP/2R3K1 w - - 0 25",
+            "8/5pk1/6p1/7p/7P/6P1/5PK1/8 w - - 0 40",
+            "8/8/4k3/8/2R5/4K3/8/8 w - - 0 1",
+        };
+
+        // Mate problems for "solve epd"; each line is a FEN with a "dm <moves>" operation
+        static constexpr const char* kMateEpdPath = "res/epd/mates.epd";
+        static constexpr int kSolveMaxMoves = 5;
+
         std::istream* m_in = nullptr;
         std::ostream* m_out = nullptr;
         std::mutex m_outMx;
@@ -69,12 +95,12 @@ namespace bq {
         Color   m_defaultColor = WHITE;
         ChessAi m_ai;
         Position m_pos;
+        MateSolver m_solver;
 
         int m_hashMb = 16;
         int m_threads = 1;
 
-        std::mutex m_thinkMx;
-        std::thread m_thinkThread;
+        ThreadPool m_pool;
         std::atomic<bool> m_thinking{ false };
         std::atomic<bool> m_quit{ false };
 
@@ -109,43 +135,16 @@ namespace bq {
         }
 
         template <Color Us>
-        static bool isLegal(Position& p, Move m) {
-            MoveList<Us> moves(p);
-            for (Move mv : moves) if (mv == m) return true;
-            return false;
+        static bool isLegal(const Position& p, Move m) {
+            return p.is_pseudo_legal<Us>(m) && p.is_legal<Us>(m);
         }
 
         static std::optional<std::pair<Move, Color>> parseUciMoveToken(Position& p, const std::string& uciTok) {
-            auto matchIn = [&](auto& ml) -> std::optional<Move> {
-                for (Move m : ml) {
-                    if (m.str() == uciTok) return m;
-                }
-                return std::nullopt;
-                };
-
-            if (hasSideToMove(p)) {
-                Color stm = getSideToMove(p);
-                if (stm == WHITE) {
-                    MoveList<WHITE> ml(p);
-                    if (auto mv = matchIn(ml)) return std::make_pair(*mv, WHITE);
-                }
-                else {
-                    MoveList<BLACK> ml(p);
-                    if (auto mv = matchIn(ml)) return std::make_pair(*mv, BLACK);
-                }
-                return std::nullopt;
-            }
-            else {
-                {
-                    MoveList<WHITE> ml(p);
-                    if (auto mv = matchIn(ml)) return std::make_pair(*mv, WHITE);
-                }
-                {
-                    MoveList<BLACK> ml(p);
-                    if (auto mv = matchIn(ml)) return std::make_pair(*mv, BLACK);
-                }
-                return std::nullopt;
-            }
+            const Move mv = p.parse_move(uciTok);
+            const Color stm = getSideToMove(p);
+            const bool legal = (stm == WHITE) ? isLegal<WHITE>(p, mv) : isLegal<BLACK>(p, mv);
+            if (!legal) return std::nullopt;
+            return std::make_pair(mv, stm);
         }
 
         void handleCommand(const std::string& line) {
@@ -162,7 +161,9 @@ namespace bq {
             else if (cmd == "stop")       onStop();
             else if (cmd == "quit")       onQuit();
             else if (cmd == "setoption")  onSetOption(toks);
-            else if (cmd == "ponderhit") {  }
+            else if (cmd == "ponderhit")  onPonderhit();
+            else if (cmd == "bench")      onBench(toks);
+            else if (cmd == "solve")      onSolve(toks);
             else {
             }
         }
@@ -173,6 +174,8 @@ namespace bq {
             writeLine("option name Hash type spin default 16 min 1 max 2048");
             writeLine("option name Threads type spin default 1 min 1 max 256");
             writeLine("option name Move Overhead type spin default 5 min 0 max 10000");
+            writeLine("option name MultiPV type spin default 1 min 1 max 256");
+            writeLine("option name Ponder type check default false");
             writeLine("option name SyzygyPath type string default");
             writeLine("option name UCI_ShowWDL type check default false");
             writeLine("uciok");
@@ -235,17 +238,24 @@ namespace bq {
             TimeControl tc{};
             bool hasTime = false;
             bool infinite = false;
+            bool ponder = false;
             int depthLimit = -1;
             long long moveTimeMs = -1;
+            SearchLimits limits;
 
             for (std::size_t i = 1; i < toks.size(); ++i) {
                 const std::string& k = toks[i];
 
+                // A value that is not a number is reported and the limit left out, so the search still runs
                 auto readLL = [&](long long& out) {
-                    if (i + 1 < toks.size()) out = std::stoll(toks[++i]);
+                    if (i + 1 >= toks.size()) return;
+                    if (const auto v = parseInt<long long>(toks[++i])) out = *v;
+                    else writeLine("info string go: bad " + k + " '" + toks[i] + "'");
                     };
                 auto readI = [&](int& out) {
-                    if (i + 1 < toks.size()) out = std::stoi(toks[++i]);
+                    if (i + 1 >= toks.size()) return;
+                    if (const auto v = parseInt(toks[++i])) out = *v;
+                    else writeLine("info string go: bad " + k + " '" + toks[i] + "'");
                     };
 
                 if (k == "wtime") { long long ms = 0; readLL(ms); tc.wtimeUs = ms * 1000; hasTime = true; }
@@ -255,8 +265,18 @@ namespace bq {
                 else if (k == "movestogo") { int v = 0; readI(v); tc.movestogo = v; }
                 else if (k == "depth") { int v = 0; readI(v); depthLimit = v; }
                 else if (k == "movetime") { long long v = 0; readLL(v); moveTimeMs = v; }
+                else if (k == "nodes") { long long v = 0; readLL(v); limits.nodes = std::max(0LL, v); }
+                else if (k == "mate") { int v = 0; readI(v); limits.mate = std::max(0, v); }
                 else if (k == "infinite") { infinite = true; }
-                else if (k == "ponder") {  }
+                else if (k == "ponder") { ponder = true; }
+                else if (k == "searchmoves") {
+                    while (i + 1 < toks.size()) {
+                        auto parsed = parseUciMoveToken(m_pos, toks[i + 1]);
+                        if (!parsed.has_value()) break;
+                        limits.searchMoves.push_back(parsed->first);
+                        ++i;
+                    }
+                }
             }
 
             Color stm = m_defaultColor;
@@ -270,30 +290,40 @@ namespace bq {
             if (moveTimeMs > 0) {
                 if (stm == WHITE) tc.wtimeUs = moveTimeMs * 1000;
                 else              tc.btimeUs = moveTimeMs * 1000;
-                tc.movestogo = 1;
+                tc.fixedBudget = true;
                 hasTime = true;
                 m_ai.setOverheadUs(0);
             }
+            else if (!hasTime && (limits.nodes > 0 || limits.mate > 0)) {
+                // A node or mate budget on its own is not cut short by the clock
+                infinite = true;
+            }
             else if (!hasTime && !infinite) {
                 if (stm == WHITE) tc.wtimeUs = 100 * 1000;
                 else              tc.btimeUs = 100 * 1000;
-                tc.movestogo = 1;
+                tc.fixedBudget = true;
                 hasTime = true;
             }
 
             if (infinite) {
                 if (stm == WHITE) tc.wtimeUs = 24LL * 60 * 60 * 1'000'000;
                 else              tc.btimeUs = 24LL * 60 * 60 * 1'000'000;
-                tc.movestogo = 1;
+                tc.fixedBudget = true;
             }
 
-            startThinking(tc);
+            m_ai.setPondering(ponder);
+            startThinking(tc, limits);
         }
 
         void onStop() {
             stopThinkingIfNeeded();
         }
 
+        // The opponent played the expected move: the ponder search carries on as a normal timed search
+        void onPonderhit() {
+            m_ai.ponderhit();
+        }
+
         void onQuit() {
             m_quit.store(true, std::memory_order_relaxed);
         }
@@ -321,16 +351,30 @@ namespace bq {
 
             name = trim(name);
             value = trim(value);
+
+            // A spin value that is not a number is reported and leaves the option as it was
+            auto spin = [&]() -> std::optional<int> {
+                const std::optional<int> v = parseInt(value);
+                if (!v) writeLine("info string bad " + name + " value");
+                return v;
+                };
+
             if (name == "Hash" && !value.empty()) {
-                m_hashMb = std::clamp(std::stoi(value), 1, 2048);
+                if (const auto v = spin()) m_hashMb = std::clamp(*v, 1, 2048);
                 //todo
             }
             else if (name == "Threads" && !value.empty()) {
-                //todo
+                const auto v = spin();
+                if (!v) return;
+                m_threads = std::clamp(*v, 1, 256);
+                stopThinkingIfNeeded();
+                m_pool.resize(m_threads);
+            }
+            else if (name == "MultiPV" && !value.empty()) {
+                if (const auto v = spin()) m_ai.setMultiPv(std::clamp(*v, 1, 256));
             }
             else if (name == "Move Overhead" && !value.empty()) {
-                int ms = std::max(0, std::stoi(value));
-                m_ai.setOverheadUs((long long)ms * 1000);
+                if (const auto v = spin()) m_ai.setOverheadUs((long long)std::max(0, *v) * 1000);
             }
             else if (name == "SyzygyPath" && !value.empty()) {
                 //todo
@@ -340,14 +384,266 @@ namespace bq {
             }
         }
 
-        void startThinking(const TimeControl& tc) {
+        void onBench(const std::vector<std::string>& toks) {
+            stopThinkingIfNeeded();
+
+            if (toks.size() > 1 && toks[1] == "eval") {
+                onEvalBench(toks);
+                return;
+            }
+
+            int depth = kBenchDepth;
+            if (toks.size() > 1) {
+                const std::optional<int> parsed = parseInt(toks[1]);
+                if (!parsed) {
+                    writeLine("info string bench: bad depth '" + toks[1] + "'");
+                    return;
+                }
+                depth = std::max(1, *parsed);
+            }
+
+            // A small table of its own, so the bench does not allocate a second full-size one
+            bq::Search search(50, kBenchHashMb);
+            long long totalNodes = 0;
+            long long totalUs = 0;
+
+            for (const char* fen : kBenchFens) {
+                Position p(fen);
+                search.clear(); // not timed: only the searches count towards nps
+
+                const auto start = std::chrono::steady_clock::now();
+                const bq::SearchStats s = (p.turn() == WHITE)
+                    ? search.initiateIterativeSearch<WHITE>(p, depth)
+                    : search.initiateIterativeSearch<BLACK>(p, depth);
+                totalUs += std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+
+                totalNodes += s.nodesSearched;
+                writeLine(std::string("info string bench ") + fen + " nodes " + std::to_string(s.nodesSearched)
+                    + " bestmove " + s.selectedMove.str());
+            }
+
+            const long long ms = totalUs / 1000;
+
+            writeLine("Total time (ms) : " + std::to_string(ms));
+            writeLine("Nodes searched  : " + std::to_string(totalNodes));
+            writeLine("Nodes/second    : " + std::to_string(totalUs > 0 ? totalNodes * 1'000'000 / totalUs : 0));
+        }
+
+        // Whole-token integer, or nothing for text std::stoi would reject or throw on
+        template <typename T = int>
+        static std::optional<T> parseInt(const std::string& s) {
+            T v = 0;
+            const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+            if (ec != std::errc() || end != s.data() + s.size()) return std::nullopt;
+            return v;
+        }
+
+        // "bench eval [rounds]" times the static evaluation alone: each round plays every legal move of the
+        // bench positions, evaluates the result and takes the move back
+        void onEvalBench(const std::vector<std::string>& toks) {
+            int rounds = kEvalBenchRounds;
+            if (toks.size() > 2) {
+                const std::optional<int> parsed = parseInt(toks[2]);
+                if (!parsed) {
+                    writeLine("info string bench eval: bad rounds '" + toks[2] + "'");
+                    return;
+                }
+                rounds = std::max(1, *parsed);
+            }
+
+            std::vector<Position> positions;
+            for (const char* fen : kBenchFens) positions.emplace_back(fen);
+
+            long long evals = 0;
+            long long checksum = 0;
+            const auto start = std::chrono::steady_clock::now();
+
+            for (int r = 0; r < rounds; ++r) {
+                for (Position& p : positions) {
+                    if (p.turn() == WHITE) evalChildren<WHITE>(p, evals, checksum);
+                    else evalChildren<BLACK>(p, evals, checksum);
+                }
+            }
+
+            const long long us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+
+            writeLine("Evaluations     : " + std::to_string(evals));
+            writeLine("Total time (ms) : " + std::to_string(us / 1000));
+            writeLine("Evals/second    : " + std::to_string(us > 0 ? evals * 1'000'000 / us : 0));
+            writeLine("Checksum        : " + std::to_string(checksum));
+        }
+
+        template <Color Us>
+        static void evalChildren(Position& p, long long& evals, long long& checksum) {
+            MoveList<Us> moves(p);
+            for (const Move& m : moves) {
+                p.play<Us>(m);
+                checksum += Evaluation::ScoreBoard<~Us>(p);
+                p.undo<Us>(m);
+            }
+            evals += (long long)moves.size();
+        }
+
+        // "solve [mate <moves>] [nodes <n>]" proves a forced mate for the side to move with the mate solver.
+        // "solve epd [<file>] [mate <moves>] [nodes <n>]" runs it over a file of mate problems and reports totals;
+        // there each problem is searched up to its own "dm" length unless mate is given.
+        void onSolve(const std::vector<std::string>& toks) {
+            stopThinkingIfNeeded();
+
+            int mate = 0;
+            long long nodes = 0;
+            bool epd = false;
+            std::string path = kMateEpdPath;
+            for (std::size_t i = 1; i < toks.size(); ++i) {
+                if (toks[i] == "mate" && i + 1 < toks.size()) {
+                    const std::optional<int> parsed = parseInt(toks[++i]);
+                    if (!parsed) {
+                        writeLine("info string solve: bad mate '" + toks[i] + "'");
+                        return;
+                    }
+                    mate = std::max(1, *parsed);
+                }
+                else if (toks[i] == "nodes" && i + 1 < toks.size()) {
+                    const std::optional<long long> parsed = parseInt<long long>(toks[++i]);
+                    if (!parsed) {
+                        writeLine("info string solve: bad nodes '" + toks[i] + "'");
+                        return;
+                    }
+                    nodes = std::max(0LL, *parsed);
+                }
+                else if (toks[i] == "epd") epd = true;
+                else if (epd) path = toks[i];
+            }
+
+            // Run on the search thread like "go", so "stop" and "isready" are still read while it works
             m_thinking.store(true, std::memory_order_relaxed);
+            m_solver.clearStop();
+
+            m_pool.main().start([this, mate, nodes, epd, path]() {
+                if (epd) {
+                    solveEpd(path, mate, nodes);
+                }
+                else {
+                    const MateResult r = solveMate(m_pos, mate > 0 ? mate : kSolveMaxMoves, nodes);
+                    writeSolveResult(r, mate > 0 ? mate : kSolveMaxMoves);
+                }
+                m_thinking.store(false, std::memory_order_relaxed);
+                });
+        }
+
+        void solveEpd(const std::string& path, int mate, long long nodes) {
+            std::ifstream in(path);
+            if (!in) {
+                writeLine("info string could not open " + path);
+                return;
+            }
 
-            std::lock_guard<std::mutex> lk(m_thinkMx);
-            m_thinkThread = std::thread([this, tc]() {
+            int problems = 0, solved = 0;
+            long long totalNodes = 0, totalUs = 0;
+            std::string line;
+            while (std::getline(in, line) && !m_solver.stopped()) {
+                const auto fields = splitWS(line);
+                if (fields.size() < 4 || fields[0][0] == '#') continue;
+
+                int dm = 0;
+                for (std::size_t i = 4; i + 1 < fields.size(); ++i)
+                    if (fields[i] == "dm") dm = std::atoi(fields[i + 1].c_str());
+                if (dm <= 0) continue;
+
+                const std::string fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3];
+                Position p(fen);
+                const MateResult r = solveMate(p, mate > 0 ? mate : dm, nodes);
+
+                ++problems;
+                const bool ok = r.proven && r.moves == dm;
+                if (ok) ++solved;
+                totalNodes += r.nodes;
+                totalUs += r.timeUs;
+
+                std::string msg = "info string solve " + fen + " dm " + std::to_string(dm)
+                    + (ok ? " ok" : r.proven ? " found mate " + std::to_string(r.moves) : " failed")
+                    + " nodes " + std::to_string(r.nodes) + " time " + std::to_string(r.timeUs / 1000);
+                writeLine(msg);
+            }
+
+            const long long ms = totalUs / 1000;
+            writeLine("Problems solved : " + std::to_string(solved) + "/" + std::to_string(problems));
+            writeLine("Total time (ms) : " + std::to_string(ms));
+            writeLine("Nodes searched  : " + std::to_string(totalNodes));
+            writeLine("Nodes/second    : " + std::to_string(totalUs > 0 ? totalNodes * 1'000'000 / totalUs : 0));
+        }
+
+        MateResult solveMate(Position& p, int maxMoves, long long nodes) {
+            m_solver.clear();
+            return (p.turn() == WHITE) ? m_solver.solve<WHITE>(p, maxMoves, nodes)
+                                       : m_solver.solve<BLACK>(p, maxMoves, nodes);
+        }
+
+        void writeSolveResult(const MateResult& r, int maxMoves) {
+            const long long nps = (r.timeUs > 0) ? r.nodes * 1'000'000LL / r.timeUs : 0;
+            const std::string counts = " nodes " + std::to_string(r.nodes) + " nps " + std::to_string(nps)
+                + " time " + std::to_string(r.timeUs / 1000);
+
+            if (r.proven) {
+                std::string line = "info depth " + std::to_string(2 * r.moves - 1)
+                    + " score mate " + std::to_string(r.moves) + counts + " pv";
+                for (Move m : r.line) line += " " + m.str();
+                writeLine(line);
+            }
+            else if (r.refuted) {
+                writeLine("info string no mate in " + std::to_string(maxMoves) + counts);
+            }
+            else {
+                writeLine("info string mate search stopped" + counts);
+            }
+        }
+
+        static std::string formatScore(int score) {
+            constexpr int kMate = Search::CHECKMATE_SCORE;
+            if (std::abs(score) >= kMate - 256) {
+                const int plies = kMate - std::abs(score);
+                const int moves = (plies + 1) / 2;
+                return "mate " + std::to_string(score > 0 ? moves : -moves);
+            }
+            return "cp " + std::to_string(score);
+        }
+
+        // One "info" line per MultiPV line; line 1 is the search's reported result
+        void writeInfo(const SearchStats& s, const std::vector<RootMove>& roots, int lines) {
+            const long long ms = s.ellapsedTime / 1000;
+            const long long nps = (s.ellapsedTime > 0) ? s.nodesSearched * 1'000'000LL / s.ellapsedTime : 0;
+
+            for (int i = 0; i < lines; ++i) {
+                const RootMove& rm = roots[i];
+                const int score = (i == 0) ? s.score : rm.score;
+                const Move* pv = (i == 0) ? s.pv.data() : rm.pv.data();
+                const int pvLen = (i == 0) ? s.pvLen : rm.pvLen;
+                if (score == RootMove::NONE || pvLen == 0) continue;
+
+                std::string line = "info depth " + std::to_string(s.depth)
+                    + " multipv " + std::to_string(i + 1)
+                    + " score " + formatScore(score)
+                    + " nodes " + std::to_string(s.nodesSearched)
+                    + " nps " + std::to_string(nps)
+                    + " time " + std::to_string(ms)
+                    + " pv";
+                for (int j = 0; j < pvLen; ++j)
+                    line += " " + pv[j].str();
+                writeLine(line);
+            }
+        }
+
+        void startThinking(const TimeControl& tc, const SearchLimits& limits) {
+            m_thinking.store(true, std::memory_order_relaxed);
+            // Cleared here rather than in the worker, so a "stop" right behind "go" reaches the search
+            m_ai.clearStop();
+
+            m_pool.main().start([this, tc, limits]() {
                 writeLine("info string thinking");
 
-                Move best = m_ai.think(m_pos, tc);
+                Move best = m_ai.think(m_pos, tc, limits);
 
                 if (best.is_null()) {
                     Move fallback{};
@@ -363,25 +659,22 @@ namespace bq {
                     if (ok) best = fallback;
                 }
 
-                if (!best.is_null()) writeLine(std::string("bestmove ") + best.str());
-                else                 writeLine("bestmove 0000");
+                const Move ponderMove = m_ai.ponderMove();
+                if (best.is_null())            writeLine("bestmove 0000");
+                else if (ponderMove.is_null()) writeLine(std::string("bestmove ") + best.str());
+                else                           writeLine(std::string("bestmove ") + best.str() + " ponder " + ponderMove.str());
 
                 m_thinking.store(false, std::memory_order_relaxed);
                 });
         }
 
         void stopThinkingIfNeeded() {
-            if (!m_thinking.load(std::memory_order_relaxed)) {
-                std::lock_guard<std::mutex> lk(m_thinkMx);
-                if (m_thinkThread.joinable()) m_thinkThread.join();
-                return;
+            if (m_thinking.load(std::memory_order_relaxed)) {
+                m_ai.stop();
+                m_solver.stop();
             }
 
-            m_ai.stop();
-
-            std::lock_guard<std::mutex> lk(m_thinkMx);
-            if (m_thinkThread.joinable()) m_thinkThread.join();
-
+            m_pool.waitAll();
             m_thinking.store(false, std::memory_order_relaxed);
         }
     };
@@ -67,33 +67,24 @@ bq::Book::resolveTokensToMoves(Position& p, const std::vector<std::string>& toke
     for (const auto& token : tokens)
     {
         bool matched = false;
+        const Move move = p.parse_move(token);
 
         if (p.turn() == WHITE)
         {
-            MoveList<WHITE> moves(p);
-            for (Move move : moves)
+            if (p.is_pseudo_legal<WHITE>(move) && p.is_legal<WHITE>(move))
             {
-                if (move.str() == token)
-                {
-                    updated_tokens.push_back(move.str());
-                    p.play<WHITE>(move);
-                    matched = true;
-                    break;
-                }
+                updated_tokens.push_back(move.str());
+                p.play<WHITE>(move);
+                matched = true;
             }
         }
         else
         {
-            MoveList<BLACK> moves(p);
-            for (Move move : moves)
+            if (p.is_pseudo_legal<BLACK>(move) && p.is_legal<BLACK>(move))
             {
-                if (move.str() == token)
-                {
-                    updated_tokens.push_back(move.str());
-                    p.play<BLACK>(move);
-                    matched = true;
-                    break;
-                }
+                updated_tokens.push_back(move.str());
+                p.play<BLACK>(move);
+                matched = true;
             }
         }
 
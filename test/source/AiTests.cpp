@@ -114,3 +114,26 @@ TEST_CASE("ChessAi: short budget tends to search less time than long budget") {
 
     CHECK(shortUs < longUs);
 }
+
+TEST_CASE("ChessAi: a real movestogo 1 keeps part of the clock in reserve") {
+    bq::ChessAi ai(WHITE, 50);
+    ai.setMaxDepth(64);
+    ai.setOverheadUs(0);
+    ai.setMinBudgetUs(0);
+
+    // Out of book, so the search runs
+    Position p("r2q1rk1/1b1nbppp/p2ppn2/1p6/3NP3/1BN1BP2/PPPQ2PP/2KR3R w - - 0 12");
+
+    bq::TimeControl tc{};
+    tc.wtimeUs = 600'000;
+    tc.movestogo = 1;
+
+    auto t0 = std::chrono::steady_clock::now();
+    Move m = ai.think(p, tc);
+    auto t1 = std::chrono::steady_clock::now();
+
+    // At most a third of the clock, where a fixed budget would take all of it
+    auto elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+    CHECK(is_legal_move<WHITE>(p, m));
+    CHECK(elapsedUs <= 200'000 + 50'000);
+}
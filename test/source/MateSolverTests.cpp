@@ -0,0 +1,104 @@
+#include "doctest.h"
+
+#include <vector>
+
+#include "surge.h"
+#include "MateSolver.h"
+
+namespace {
+
+    // Plays the line from p and reports whether it is legal and ends in checkmate
+    template <Color Us>
+    bool ends_in_mate(Position& p, const std::vector<Move>& line, std::size_t i = 0) {
+        MoveList<Us> ml(p);
+        if (i == line.size())
+            return ml.size() == 0 && p.in_check<Us>();
+
+        bool legal = false;
+        for (Move m : ml) legal |= (m == line[i]);
+        if (!legal) return false;
+
+        p.play<Us>(line[i]);
+        const bool mate = ends_in_mate<~Us>(p, line, i + 1);
+        p.undo<Us>(line[i]);
+        return mate;
+    }
+
+}
+
+TEST_SUITE("bq::MateSolver") {
+
+    TEST_CASE("proves a mate in two and returns the mating line") {
+        bq::MateSolver solver(1);
+        Position p("rn1qkbnr/ppp2p1p/3p2p1/4N3/2B1P3/2N5/PPPP1PPP/R1BbK2R w KQkq - 0 6");
+
+        const bq::MateResult r = solver.solve<WHITE>(p, 4);
+        REQUIRE(r.proven);
+        CHECK(r.moves == 2);
+        CHECK(r.line.size() == 3);
+        CHECK(r.line[0] == Move(c4, f7, CAPTURE));
+        CHECK(ends_in_mate<WHITE>(p, r.line));
+        CHECK(p.fen() == Position("rn1qkbnr/ppp2p1p/3p2p1/4N3/2B1P3/2N5/PPPP1PPP/R1BbK2R w KQkq - 0 6").fen());
+    }
+
+    TEST_CASE("reports the shortest mate for black") {
+        bq::MateSolver solver(1);
+        Position p("r1b1kb1r/pppp1ppp/5q2/4n3/3KP3/2N3PN/PPP4P/R1BQ1B1R b kq - 0 1");
+
+        const bq::MateResult r = solver.solve<BLACK>(p, 5);
+        REQUIRE(r.proven);
+        CHECK(r.moves == 3);
+        CHECK(ends_in_mate<BLACK>(p, r.line));
+    }
+
+    TEST_CASE("a long king and queen mate") {
+        bq::MateSolver solver(4);
+        Position p("8/8/8/8/8/3k4/8/2QK4 w - - 0 1");
+
+        const bq::MateResult r = solver.solve<WHITE>(p, 6);
+        REQUIRE(r.proven);
+        CHECK(r.moves == 6);
+        CHECK(ends_in_mate<WHITE>(p, r.line));
+    }
+
+    TEST_CASE("refutes positions without a mate, including stalemate traps") {
+        bq::MateSolver solver(1);
+
+        Position start("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+        bq::MateResult r = solver.solve<WHITE>(start, 2);
+        CHECK(r.refuted);
+        CHECK_FALSE(r.proven);
+        CHECK(r.line.empty());
+
+        // A lone queen cannot mate, and Qb6 only stalemates
+        Position stalemate("k7/8/2Q5/8/8/8/8/7K w - - 0 1");
+        r = solver.solve<WHITE>(stalemate, 2);
+        CHECK(r.refuted);
+    }
+
+    TEST_CASE("stops at the node budget without a verdict") {
+        bq::MateSolver solver(1);
+        Position p("2q1nk1r/4Rp2/1ppp1P2/6Pp/3p1B2/3P3P/PPP1Q3/6K1 w - - 0 1");
+
+        const bq::MateResult r = solver.solve<WHITE>(p, 5, 1'000);
+        CHECK_FALSE(r.proven);
+        CHECK_FALSE(r.refuted);
+        CHECK(r.nodes == 1'000);
+        CHECK_FALSE(solver.stopped()); // the budget ends this solve only
+    }
+
+    TEST_CASE("a stop sent before the solve starts holds until clearStop") {
+        bq::MateSolver solver(1);
+        Position p("rn1qkbnr/ppp2p1p/3p2p1/4N3/2B1P3/2N5/PPPP1PPP/R1BbK2R w KQkq - 0 6");
+
+        solver.stop();
+        bq::MateResult r = solver.solve<WHITE>(p, 4);
+        CHECK_FALSE(r.proven);
+        CHECK_FALSE(r.refuted);
+
+        solver.clearStop();
+        r = solver.solve<WHITE>(p, 4);
+        CHECK(r.proven);
+        CHECK(r.moves == 2);
+    }
+}
@@ -1,7 +1,13 @@
 
 #include "doctest.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <random>
 #include <string>
+#include <thread>
 
 #include "surge.h"
 #include "Search.h"      
@@ -28,6 +34,104 @@ namespace {
         return ml.size() == 0 && p.in_check<SideToMove>();
     }
 
+    // Counts moves where gives_check disagrees with playing the move and looking for check
+    template <Color Us>
+    int gives_check_mismatches(Position& p, int depth) {
+        int mismatches = 0;
+        MoveList<Us> ml(p);
+        for (Move m : ml) {
+            const bool predicted = p.gives_check<Us>(m);
+            p.play<Us>(m);
+            if (predicted != p.in_check<~Us>()) ++mismatches;
+            if (depth > 1) mismatches += gives_check_mismatches<~Us>(p, depth - 1);
+            p.undo<Us>(m);
+        }
+        return mismatches;
+    }
+
+    // Counts positions where the incremental material/PST score or game phase differs from a sum over the board
+    template <Color Us>
+    int accumulator_mismatches(Position& p, int depth) {
+        Score psq = 0;
+        int phase = 0;
+        for (Square s = a1; s <= h8; ++s) {
+            psq += psqt::table[p.at(s)][s];
+            phase += psqt::phase[p.at(s)];
+        }
+        int mismatches = (psq != p.psq_score()) + (phase != p.game_phase());
+        if (depth == 0) return mismatches;
+
+        MoveList<Us> ml(p);
+        for (Move m : ml) {
+            p.play<Us>(m);
+            mismatches += accumulator_mismatches<~Us>(p, depth - 1);
+            p.undo<Us>(m);
+        }
+        return mismatches + (psq != p.psq_score()) + (phase != p.game_phase());
+    }
+
+    // Counts differences between generate_quiet_checks and the non-promoting, non-castling quiet moves of
+    // MoveList that leave the opponent in check
+    template <Color Us>
+    int quiet_check_mismatches(Position& p, int depth) {
+        Move generated[218];
+        const int n = int(p.generate_quiet_checks<Us>(generated) - generated);
+
+        int expected = 0;
+        int mismatches = 0;
+        MoveList<Us> ml(p);
+        for (Move m : ml) {
+            p.play<Us>(m);
+            const bool quietCheck = (m.flags() == QUIET || m.flags() == DOUBLE_PUSH) && p.in_check<~Us>();
+            if (depth > 1) mismatches += quiet_check_mismatches<~Us>(p, depth - 1);
+            p.undo<Us>(m);
+
+            if (quietCheck) {
+                ++expected;
+                if (std::find(generated, generated + n, m) == generated + n) ++mismatches;
+            }
+        }
+        return mismatches + std::abs(n - expected);
+    }
+
+    // Compares is_pseudo_legal && is_legal with MoveList membership for random and near-miss moves, checks that
+    // every legal move survives a round trip through its UCI text, then plays a random legal move
+    template <Color Us>
+    int legality_mismatches(Position& p, std::mt19937& rng, int plies) {
+        MoveList<Us> ml(p);
+        int mismatches = 0;
+        auto judge = [&](Move m) {
+            bool listed = false;
+            for (Move x : ml) listed |= (x == m);
+            if ((p.is_pseudo_legal<Us>(m) && p.is_legal<Us>(m)) != listed) ++mismatches;
+        };
+
+        for (Move m : ml) {
+            judge(m);
+            if (p.parse_move(m.str()) != m) ++mismatches;
+        }
+
+        const Bitboard ours = p.all_pieces<Us>();
+        for (int i = 0; i < 400; ++i) {
+            const Square to = Square(rng() % 64);
+            const MoveFlags flags = MoveFlags(rng() % 16);
+            Square from = Square(rng() % 64);
+            if (i % 2 && ours) {
+                Bitboard b = ours;
+                for (int k = int(rng() % pop_count(ours)); k > 0; --k) pop_lsb(&b);
+                from = bsf(b);
+            }
+            judge(Move(from, to, flags));
+        }
+
+        if (plies == 0 || ml.size() == 0) return mismatches;
+        const Move m = ml.list[rng() % ml.size()];
+        p.play<Us>(m);
+        mismatches += legality_mismatches<~Us>(p, rng, plies - 1);
+        p.undo<Us>(m);
+        return mismatches;
+    }
+
 } 
 
 TEST_CASE("Search: startpos returns a legal move and searches some nodes") {
@@ -202,4 +306,649 @@ TEST_CASE("Search: checkmate vs stalemate terminal handling") {
 
     auto s2 = search2.initiateIterativeSearch<BLACK>(stal, 2);
     CHECK(s2.nodesSearched > 0);
-}
\ No newline at end of file
+}
+
+TEST_CASE("HistoryTable: bonuses saturate and ageing halves scores") {
+    bq::HistoryTable h;
+    const Move m(e2, e4, DOUBLE_PUSH);
+
+    for (int i = 0; i < 1000; ++i)
+        h.update(WHITE, m, 1'536);
+
+    CHECK(h.get(WHITE, m) > 0);
+    CHECK(h.get(WHITE, m) <= bq::HistoryTable::kMax);
+    CHECK(h.get(BLACK, m) == 0);
+
+    const int before = h.get(WHITE, m);
+    h.age();
+    CHECK(h.get(WHITE, m) == before / 2);
+
+    for (int i = 0; i < 1000; ++i)
+        h.update(WHITE, m, -1'536);
+    CHECK(h.get(WHITE, m) < 0);
+    CHECK(h.get(WHITE, m) >= -bq::HistoryTable::kMax);
+}
+
+TEST_CASE("CorrectionHistory: updates pull towards the search error, saturate and stay per side") {
+    bq::CorrectionHistory c;
+    const std::uint64_t pawns = 0x1234'5678'9abc'def0ULL;
+    constexpr int kBound = bq::CorrectionHistory::LIMIT / bq::CorrectionHistory::GRAIN;
+
+    CHECK(c.correct(WHITE, pawns, 50) == 50);
+
+    // Searches keep finding the position 80cp better than its eval: the correction grows towards that
+    c.update(WHITE, pawns, 8, 130, 50);
+    const int once = c.correct(WHITE, pawns, 50) - 50;
+    CHECK(once > 0);
+    c.update(WHITE, pawns, 8, 130, 50);
+    CHECK(c.correct(WHITE, pawns, 50) - 50 > once);
+
+    // The other side's entry for the same pawns is its own
+    CHECK(c.correct(BLACK, pawns, 50) == 50);
+
+    // Large errors saturate at +-LIMIT / GRAIN
+    for (int i = 0; i < 1000; ++i)
+        c.update(WHITE, pawns, 16, 5'000, 0);
+    CHECK(c.correct(WHITE, pawns, 0) == kBound);
+
+    for (int i = 0; i < 1000; ++i)
+        c.update(BLACK, pawns, 16, -5'000, 0);
+    CHECK(c.correct(BLACK, pawns, 0) == -kBound);
+    CHECK(c.correct(WHITE, pawns, 0) == kBound);
+
+    // An error the other way pulls it back
+    c.update(WHITE, pawns, 8, -100, 0);
+    CHECK(c.correct(WHITE, pawns, 0) < kBound);
+
+    c.clear();
+    CHECK(c.correct(WHITE, pawns, 0) == 0);
+    CHECK(c.correct(BLACK, pawns, 0) == 0);
+}
+
+TEST_CASE("Search: shallow quiet pruning never drops a quiet mating check") {
+    bq::Search search(50);
+    // Mate in two with the quiet 1.Rh7 and a rook check on the back rank. Most of Black's replies are searched
+    // at zero-window nodes, where White's mating check is a quiet at depth 1 behind other quiets. Without the
+    // exemption for checks the shallow pruning skips it there and no mate is found at any depth up to 6.
+    Position p("3k4/4R3/4p3/1K6/R7/8/7n/8 w - - 0 1");
+
+    auto s = search.initiateIterativeSearch<WHITE>(p, 3);
+
+    CHECK(s.mateFound);
+    CHECK(s.score == bq::Search::CHECKMATE_SCORE - 3);
+    CHECK(s.selectedMove.str() == "e7h7");
+}
+
+TEST_CASE("Position: FEN halfmove clock is parsed and tracked by play/undo") {
+    Position p("4k3/8/8/8/8/8/4P3/4K1N1 w - - 37 60");
+    CHECK(p.fifty() == 37);
+
+    p.play<WHITE>(Move(g1, f3, QUIET));
+    CHECK(p.fifty() == 38);
+    p.undo<WHITE>(Move(g1, f3, QUIET));
+    CHECK(p.fifty() == 37);
+
+    p.play<WHITE>(Move(e2, e4, DOUBLE_PUSH));
+    CHECK(p.fifty() == 0);
+}
+
+TEST_CASE("Position: FEN en passant square is parsed and written back") {
+    Position black("8/8/8/2k5/3Pp3/8/8/4KB2 b - d3 0 1");
+    CHECK(black.fen() == "8/8/8/2k5/3Pp3/8/8/4KB2 b - d3");
+    CHECK(is_legal_move<BLACK>(black, Move(e4, d3, EN_PASSANT)));
+
+    Position white("rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3");
+    CHECK(white.fen() == "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6");
+    CHECK(is_legal_move<WHITE>(white, Move(e5, f6, EN_PASSANT)));
+
+    // No target square, and partial castling rights
+    Position none("r3k3/8/8/3pP3/8/8/8/4K2R w Kq - 0 1");
+    CHECK(none.fen() == "r3k3/8/8/3pP3/8/8/8/4K2R w Kq -");
+    CHECK_FALSE(is_legal_move<WHITE>(none, Move(e5, d6, EN_PASSANT)));
+}
+
+TEST_CASE("Position: repetition needs one recurrence in the tree, two in game history") {
+    Position p("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    const Move shuffle[] = {
+        Move(g1, f3, QUIET), Move(g8, f6, QUIET), Move(f3, g1, QUIET), Move(f6, g8, QUIET),
+    };
+
+    for (int i = 0; i < 4; ++i) {
+        if (i % 2 == 0) p.play<WHITE>(shuffle[i]);
+        else            p.play<BLACK>(shuffle[i]);
+    }
+
+    CHECK(p.is_repetition(4));
+    CHECK_FALSE(p.is_repetition(0));
+
+    for (int i = 0; i < 4; ++i) {
+        if (i % 2 == 0) p.play<WHITE>(shuffle[i]);
+        else            p.play<BLACK>(shuffle[i]);
+    }
+
+    CHECK(p.is_repetition(0));
+}
+
+TEST_CASE("Search: fifty-move rule turns a won position into a draw") {
+    bq::Search search(50);
+    Position p("7k/8/8/8/8/8/8/KQ6 w - - 99 100");
+
+    auto s = search.initiateIterativeSearch<WHITE>(p, 4);
+
+    CHECK(s.score == 0);
+    CHECK(is_legal_move<WHITE>(p, s.selectedMove));
+
+    // A mate delivered on the hundredth ply still counts as mate
+    bq::Search search2(50);
+    Position mate("7k/8/6K1/8/8/8/8/Q7 w - - 99 100");
+
+    auto s2 = search2.initiateIterativeSearch<WHITE>(mate, 2);
+
+    CHECK(s2.mateFound);
+    CHECK(s2.score == bq::Search::CHECKMATE_SCORE - 1);
+    CHECK(s2.selectedMove == Move(a1, a8, QUIET));
+}
+
+TEST_CASE("Position: cuckoo table holds every reversible piece move") {
+    int filled = 0;
+    for (int i = 0; i < cuckoo::SIZE; ++i)
+        if (!cuckoo::moves[i].is_null()) ++filled;
+
+    CHECK(filled == 3668);
+}
+
+TEST_CASE("Position: upcoming repetition is detected before the move is played") {
+    Position p("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    p.play<WHITE>(Move(g1, f3, QUIET));
+    p.play<BLACK>(Move(g8, f6, QUIET));
+    p.play<WHITE>(Move(f3, g1, QUIET));
+
+    // Black can play ...Nf6-g8 and repeat the position three plies back
+    CHECK(p.has_game_cycle(4));
+    CHECK_FALSE(p.has_game_cycle(3));
+
+    // Once a pawn has moved the old position is out of reach
+    Position q("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    q.play<WHITE>(Move(g1, f3, QUIET));
+    q.play<BLACK>(Move(e7, e6, QUIET));
+    q.play<WHITE>(Move(f3, g1, QUIET));
+    CHECK_FALSE(q.has_game_cycle(4));
+}
+
+TEST_CASE("Position: null move passes the turn and is undone exactly") {
+    Position p("r3k2r/pppq1ppp/2npbn2/4p3/4P3/2NPBN2/PPPQ1PPP/R3K2R w KQkq - 7 10");
+    const auto hash = p.get_hash();
+
+    p.play_null();
+    CHECK(p.turn() == BLACK);
+    CHECK(p.get_hash() != hash);
+    CHECK(p.fifty() == 7);
+
+    p.play<BLACK>(Move(c6, b8, QUIET));
+    CHECK(p.fifty() == 8);
+    p.undo<BLACK>(Move(c6, b8, QUIET));
+
+    p.undo_null();
+    CHECK(p.turn() == WHITE);
+    CHECK(p.get_hash() == hash);
+    CHECK(p.fifty() == 7);
+}
+
+TEST_CASE("Position: a null move keeps the fifty-move count but ends repetition scans") {
+    // The fifty-move draw still arrives on the ply after a null move
+    Position p("7k/8/8/8/8/8/8/KQ6 w - - 99 100");
+    p.play_null();
+    CHECK_FALSE(p.is_fifty_move_draw());
+    p.play<BLACK>(Move(h8, g8, QUIET));
+    CHECK(p.is_fifty_move_draw());
+
+    // Nf3, pass, Ng1, pass is back at the start position, but the line runs through null moves
+    Position q("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    q.play<WHITE>(Move(g1, f3, QUIET));
+    q.play_null();
+    q.play<WHITE>(Move(f3, g1, QUIET));
+    q.play_null();
+    CHECK(q.get_hash() == Position("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1").get_hash());
+    CHECK_FALSE(q.is_repetition(4));
+    CHECK_FALSE(q.has_game_cycle(8));
+}
+
+TEST_CASE("Position: pawn hash follows pawn moves only") {
+    Position p("r2qk2r/pp3ppp/2n5/3pP3/8/5N2/PP3PPP/R3K2R w KQkq d6 0 12");
+    const auto pawns = p.get_pawn_hash();
+
+    // Piece moves and castling leave it alone
+    p.play<WHITE>(Move(f3, g5, QUIET));
+    CHECK(p.get_pawn_hash() == pawns);
+    p.undo<WHITE>(Move(f3, g5, QUIET));
+    p.play<WHITE>(Move(e1, h1, OO));
+    CHECK(p.get_pawn_hash() == pawns);
+    p.undo<WHITE>(Move(e1, h1, OO));
+
+    // Pawn pushes, en passant and a queen taking a pawn change it, and undo restores it
+    const Move moves[] = { Move(a2, a4, DOUBLE_PUSH), Move(e5, d6, EN_PASSANT), Move(d8, d6, CAPTURE) };
+    p.play<WHITE>(moves[0]);
+    CHECK(p.get_pawn_hash() != pawns);
+    p.undo<WHITE>(moves[0]);
+    p.play<WHITE>(moves[1]);
+    CHECK(p.get_pawn_hash() != pawns);
+    CHECK(p.get_pawn_hash() == Position(p.fen()).get_pawn_hash());
+    p.play<BLACK>(moves[2]);
+    CHECK(p.get_pawn_hash() == Position(p.fen()).get_pawn_hash());
+    p.undo<BLACK>(moves[2]);
+    p.undo<WHITE>(moves[1]);
+    CHECK(p.get_pawn_hash() == pawns);
+
+    // A promotion removes the pawn from it
+    Position promo("8/4P1k1/8/8/8/8/6K1/8 w - - 0 1");
+    promo.play<WHITE>(Move(e7, e8, PR_QUEEN));
+    CHECK(promo.get_pawn_hash() == 0);
+}
+
+TEST_CASE("Position: gives_check agrees with make/unmake over perft trees") {
+    const char* fens[] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "5k2/8/8/8/8/8/8/4K2R w K - 0 1",                // castling checks
+        "3k4/8/8/8/8/8/8/R3K3 w Q - 0 1",
+        "2k5/8/8/8/8/8/8/R3K3 w Q - 0 1",
+        "8/8/8/2k5/3Pp3/8/8/4KB2 b - d3 0 1",             // en passant
+        "8/8/8/R1pP3k/8/8/8/4K3 w - c6 0 1",              // en passant uncovering a rook check
+        "3k4/8/8/8/3B4/8/3R4/3K4 w - - 0 1",              // discovered checks
+        "4k3/1P6/8/8/8/8/8/4K3 w - - 0 1",                // promotions
+    };
+
+    // The en passant positions only cover anything if the capture is really generated there
+    Position epBlack("8/8/8/2k5/3Pp3/8/8/4KB2 b - d3 0 1");
+    REQUIRE(is_legal_move<BLACK>(epBlack, Move(e4, d3, EN_PASSANT)));
+    Position epWhite("8/8/8/R1pP3k/8/8/8/4K3 w - c6 0 1");
+    REQUIRE(is_legal_move<WHITE>(epWhite, Move(d5, c6, EN_PASSANT)));
+    CHECK(epWhite.gives_check<WHITE>(Move(d5, c6, EN_PASSANT)));
+
+    for (const char* fen : fens) {
+        Position p(fen);
+        CAPTURE(fen);
+        const int mismatches = (p.turn() == WHITE) ? gives_check_mismatches<WHITE>(p, 3) : gives_check_mismatches<BLACK>(p, 3);
+        CHECK(mismatches == 0);
+        CHECK(p.fen() == Position(fen).fen());
+    }
+}
+
+TEST_CASE("Position: material, PST and phase accumulators stay exact over perft trees") {
+    const char* fens[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",   // castling, captures
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",                             // en passant
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",      // promotions
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    };
+    for (const char* fen : fens) {
+        Position p(fen);
+        CAPTURE(fen);
+        const int mismatches = (p.turn() == WHITE) ? accumulator_mismatches<WHITE>(p, 3) : accumulator_mismatches<BLACK>(p, 3);
+        CHECK(mismatches == 0);
+    }
+
+    // Both sides' full armies: a level score and the opening phase
+    Position start("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    CHECK(start.psq_score() == 0);
+    CHECK(start.game_phase() == 24);
+}
+
+TEST_CASE("Position: quiet check generation agrees with make/unmake over perft trees") {
+    const char* fens[] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "3k4/8/8/8/3B4/8/3R4/3K4 w - - 0 1",              // discovered checks by a bishop
+        "7k/8/8/8/3P4/2B5/8/K7 w - - 0 1",                // ... and by a pawn push
+        "8/8/8/k7/8/8/1P6/7K w - - 0 1",                  // pawn double push check
+        "4k3/8/8/8/1b6/8/3N4/4K1Q1 w - - 0 1",            // pinned knight may not check
+    };
+    for (const char* fen : fens) {
+        Position p(fen);
+        CAPTURE(fen);
+        const int mismatches = (p.turn() == WHITE) ? quiet_check_mismatches<WHITE>(p, 3) : quiet_check_mismatches<BLACK>(p, 3);
+        CHECK(mismatches == 0);
+        CHECK(p.fen() == Position(fen).fen());
+    }
+}
+
+TEST_CASE("Position: move validation agrees with move generation") {
+    const char* fens[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "8/8/8/K1pP3k/8/8/8/8 w - c6 0 1",                    // en passant
+        "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+        "r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1",
+    };
+
+    // En passant is generated where the FEN offers it...
+    Position ep("8/8/8/K1pP3k/8/8/8/8 w - c6 0 1");
+    REQUIRE(is_legal_move<WHITE>(ep, Move(d5, c6, EN_PASSANT)));
+    CHECK(ep.is_pseudo_legal<WHITE>(Move(d5, c6, EN_PASSANT)));
+    CHECK(ep.is_legal<WHITE>(Move(d5, c6, EN_PASSANT)));
+    CHECK_FALSE(ep.is_pseudo_legal<WHITE>(Move(d5, e6, EN_PASSANT)));
+
+    // ...and refused when taking both pawns off the rank would expose the king to the rook
+    Position pinned("8/8/8/K1pP3r/8/8/8/7k w - c6 0 1");
+    CHECK_FALSE(is_legal_move<WHITE>(pinned, Move(d5, c6, EN_PASSANT)));
+    CHECK(pinned.is_pseudo_legal<WHITE>(Move(d5, c6, EN_PASSANT)));
+    CHECK_FALSE(pinned.is_legal<WHITE>(Move(d5, c6, EN_PASSANT)));
+
+    std::mt19937 rng(12345);
+    for (const char* fen : fens) {
+        CAPTURE(fen);
+        for (int game = 0; game < 4; ++game) {
+            Position p(fen);
+            const int mismatches = (p.turn() == WHITE) ? legality_mismatches<WHITE>(p, rng, 30)
+                                                       : legality_mismatches<BLACK>(p, rng, 30);
+            CHECK(mismatches == 0);
+        }
+    }
+
+    Position p("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    CHECK(p.parse_move("e2e4").flags() == DOUBLE_PUSH);
+    CHECK_FALSE(p.is_pseudo_legal<WHITE>(p.parse_move("e2e5")));
+    CHECK(p.parse_move("e2").is_null());
+    CHECK(p.parse_move("e2e4x").is_null());
+    CHECK(p.parse_move("i2e4").is_null());
+}
+
+TEST_CASE("Position: static exchange evaluation") {
+    // Undefended pawn
+    Position free("1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1");
+    CHECK(free.see_ge(Move(e1, e5, CAPTURE), 100));
+    CHECK_FALSE(free.see_ge(Move(e1, e5, CAPTURE), 101));
+
+    // Rook takes a pawn defended by a pawn
+    Position defended("4k3/8/3p4/4p3/8/8/8/4R1K1 w - - 0 1");
+    CHECK_FALSE(defended.see_ge(Move(e1, e5, CAPTURE), 0));
+    CHECK(defended.see_ge(Move(e1, e5, CAPTURE), -400));
+    CHECK_FALSE(defended.see_ge(Move(e1, e5, CAPTURE), -399));
+
+    // The rook behind the first attacker joins in once the first one has captured
+    Position xray("4k3/4r3/8/4p3/8/8/4R3/4R1K1 w - - 0 1");
+    CHECK(xray.see_ge(Move(e2, e5, CAPTURE), 100));
+    CHECK_FALSE(xray.see_ge(Move(e2, e5, CAPTURE), 101));
+
+    // A quiet move onto a square a pawn attacks
+    Position quiet("4k3/8/8/3p4/8/8/8/K3R3 w - - 0 1");
+    CHECK_FALSE(quiet.see_ge(Move(e1, e4, QUIET), 0));
+    CHECK(quiet.see_ge(Move(e1, e4, QUIET), -500));
+}
+
+TEST_CASE("Search: hard deadline stops the search promptly") {
+    using Clock = bq::SearchLimits::Clock;
+    bq::Search search(50);
+    Position p("r2q1rk1/1b1nbppp/p2ppn2/1p6/3NP3/1BN1BP2/PPPQ2PP/2KR3R w - - 0 12");
+
+    bq::SearchLimits limits;
+    limits.hardDeadline = Clock::now() + std::chrono::milliseconds(50);
+
+    auto s = search.initiateIterativeSearch<WHITE>(p, 64, limits);
+    const auto latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - limits.hardDeadline).count();
+
+    MESSAGE("stop latency after hard deadline: " << latencyUs << "us");
+    CHECK(latencyUs < 20'000);
+    CHECK(s.depth < 64);
+    CHECK(is_legal_move<WHITE>(p, s.selectedMove));
+}
+
+TEST_CASE("Search: soft deadline lets the running iteration finish") {
+    using Clock = bq::SearchLimits::Clock;
+    bq::Search search(50);
+    Position p("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+
+    bq::SearchLimits limits;
+    limits.softDeadline = Clock::now();
+
+    auto s = search.initiateIterativeSearch<WHITE>(p, 64, limits);
+
+    CHECK(s.depth == 1);
+    CHECK(is_legal_move<WHITE>(p, s.selectedMove));
+}
+
+TEST_CASE("Search: external stop is picked up by the node poll") {
+    using Clock = bq::SearchLimits::Clock;
+    bq::Search search(50);
+    Position p("r2q1rk1/1b1nbppp/p2ppn2/1p6/3NP3/1BN1BP2/PPPQ2PP/2KR3R w - - 0 12");
+
+    Clock::time_point stoppedAt;
+    std::thread stopper([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        stoppedAt = Clock::now();
+        search.signalStop();
+    });
+
+    auto s = search.initiateIterativeSearch<WHITE>(p, 64);
+    const auto done = Clock::now();
+    stopper.join();
+
+    const auto latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(done - stoppedAt).count();
+    MESSAGE("stop latency after signalStop: " << latencyUs << "us");
+    CHECK(latencyUs < 20'000);
+    CHECK(is_legal_move<WHITE>(p, s.selectedMove));
+}
+
+TEST_CASE("Search: root move list holds every legal move with the best one first") {
+    bq::Search search(50);
+    Position p("r3k2r/pppq1ppp/2npbn2/4p3/4P3/2NPBN2/PPPQ1PPP/R3K2R w KQkq - 0 1");
+
+    auto s = search.initiateIterativeSearch<WHITE>(p, 6);
+    const auto& roots = search.rootMoves();
+
+    MoveList<WHITE> legal(p);
+    REQUIRE(roots.size() == legal.size());
+
+    const bq::RootMove& best = roots.front();
+    CHECK(best.move == s.selectedMove);
+    CHECK(best.score == s.score);
+    REQUIRE(best.pvLen == s.pvLen);
+    for (int i = 0; i < best.pvLen; ++i)
+        CHECK(best.pv[i] == s.pv[i]);
+
+    long long rootNodes = 0;
+    for (const auto& rm : roots) {
+        CHECK(is_legal_move<WHITE>(p, rm.move));
+        rootNodes += rm.nodes;
+    }
+    CHECK(best.nodes > 0);
+    CHECK(rootNodes <= s.nodesSearched);
+}
+
+TEST_CASE("Search: MultiPV reports distinct lines in score order every iteration") {
+    bq::Search search(50);
+    search.setMultiPv(3);
+    Position p("r3k2r/pppq1ppp/2npbn2/4p3/4P3/2NPBN2/PPPQ1PPP/R3K2R w KQkq - 0 1");
+
+    int iterations = 0;
+    search.setInfoCallback([&](const bq::SearchStats& s, const std::vector<bq::RootMove>& roots, int lines) {
+        ++iterations;
+        REQUIRE(lines == 3);
+        CHECK(roots[0].move == s.selectedMove);
+        CHECK(roots[0].move != roots[1].move);
+        CHECK(roots[1].move != roots[2].move);
+        CHECK(roots[0].score >= roots[1].score);
+        CHECK(roots[1].score >= roots[2].score);
+        CHECK(roots[2].score != bq::RootMove::NONE);
+    });
+
+    auto s = search.initiateIterativeSearch<WHITE>(p, 5);
+    CHECK(iterations == 5);
+    CHECK(is_legal_move<WHITE>(p, s.selectedMove));
+}
+
+TEST_CASE("Search: searchmoves restricts the root move list") {
+    bq::Search search(50);
+    Position p("6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1");
+
+    bq::SearchLimits limits;
+    limits.searchMoves = { Move(h2, h3, QUIET), Move(g1, f1, QUIET) };
+
+    auto s = search.initiateIterativeSearch<WHITE>(p, 4, limits);
+
+    CHECK(search.rootMoves().size() == 2);
+    CHECK(s.selectedMove.str() != "d1d8");
+    CHECK(!s.mateFound);
+}
+
+TEST_CASE("Search: a ponder search ignores its deadlines until ponderhit") {
+    using Clock = bq::SearchLimits::Clock;
+    bq::Search search(50);
+    Position p("r2q1rk1/1b1nbppp/p2ppn2/1p6/3NP3/1BN1BP2/PPPQ2PP/2KR3R w - - 0 12");
+
+    bq::SearchLimits limits;
+    limits.softDeadline = Clock::now() + std::chrono::milliseconds(10);
+    limits.hardDeadline = Clock::now() + std::chrono::milliseconds(20);
+
+    std::atomic<bool> done{ false };
+    bq::SearchStats s;
+    search.setPondering(true);
+    std::thread worker([&] {
+        s = search.initiateIterativeSearch<WHITE>(p, 64, limits);
+        done = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK_FALSE(done.load());
+
+    const auto hit = Clock::now();
+    search.ponderhit();
+    worker.join();
+    const auto afterHitUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - hit).count();
+
+    MESSAGE("search time after ponderhit: " << afterHitUs << "us");
+    CHECK(afterHitUs < 60'000);
+    CHECK(is_legal_move<WHITE>(p, s.selectedMove));
+}
+
+TEST_CASE("Search: node budget is met exactly and is reproducible") {
+    Position p("r2q1rk1/1b1nbppp/p2ppn2/1p6/3NP3/1BN1BP2/PPPQ2PP/2KR3R w - - 0 12");
+
+    bq::SearchLimits limits;
+    limits.nodes = 20'000;
+
+    bq::Search a(50);
+    auto s1 = a.initiateIterativeSearch<WHITE>(p, 64, limits);
+    bq::Search b(50);
+    auto s2 = b.initiateIterativeSearch<WHITE>(p, 64, limits);
+
+    CHECK(s1.nodesSearched == 20'000);
+    CHECK(s2.nodesSearched == 20'000);
+    CHECK(s1.selectedMove == s2.selectedMove);
+    CHECK(s1.depth == s2.depth);
+    CHECK(is_legal_move<WHITE>(p, s1.selectedMove));
+}
+
+TEST_CASE("Search: a stopped iteration keeps a better root move it had already found") {
+    Position p("8/8/4k3/8/2R5/4K3/8/8 w - - 0 1");
+
+    // The budget runs out in the depth 4 iteration, after a move other than the depth 3 best has beaten alpha
+    bq::SearchLimits limits;
+    limits.nodes = 1'250;
+
+    bq::Search search(50);
+    Move lastCompleted{};
+    int completedDepth = 0;
+    search.setInfoCallback([&](const bq::SearchStats& s, const std::vector<bq::RootMove>&, int) {
+        lastCompleted = s.selectedMove;
+        completedDepth = s.depth;
+    });
+
+    auto s = search.initiateIterativeSearch<WHITE>(p, 64, limits);
+
+    REQUIRE(completedDepth == 3);
+    CHECK(s.selectedMove != lastCompleted);
+    CHECK(s.selectedMove == search.rootMoves().front().move);
+    CHECK(search.rootMoves().front().score != bq::RootMove::NONE);
+    CHECK(s.score == search.rootMoves().front().score);
+    CHECK(is_legal_move<WHITE>(p, s.selectedMove));
+}
+
+TEST_CASE("Search: mate limit stops once a short enough mate is proven") {
+    bq::Search search(50);
+    Position p("6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1");
+
+    bq::SearchLimits limits;
+    limits.mate = 1;
+
+    auto s = search.initiateIterativeSearch<WHITE>(p, 64, limits);
+
+    CHECK(s.mateFound);
+    CHECK(s.selectedMove.str() == "d1d8");
+    CHECK(s.depth < 64);
+}
+
+TEST_CASE("Search: singular verification leaves the node's state intact") {
+    // No excluded move may outlive its verification search
+    auto stackIsClean = [](const bq::Search& search) {
+        for (int ply = 0; ply < search.stack().size(); ++ply)
+            if (!search.stack()[ply].excludedMove.is_null()) return false;
+        return true;
+    };
+
+    // Kxe2 is the only legal move; deep enough that its hash entries get tested for singularity
+    bq::Search search(50);
+    Position only("4k3/8/8/8/8/8/4q3/4K2R w K - 0 1");
+
+    auto s = search.initiateIterativeSearch<WHITE>(only, 10);
+    CHECK(s.singularSearches > 0);
+    CHECK(s.selectedMove == Move(e1, e2, CAPTURE));
+    CHECK(s.score > 300);
+    CHECK(stackIsClean(search));
+
+    // Deeper from the filled hash table, so the verification searches start from deep hash hits
+    auto again = search.initiateIterativeSearch<WHITE>(only, 12);
+    CHECK(again.singularSearches > 0);
+    CHECK(again.selectedMove == s.selectedMove);
+    CHECK(again.score > 300);
+    CHECK(stackIsClean(search));
+
+    // A won rook ending where verification searches also fail high and cut their nodes
+    bq::Search search2(50);
+    Position rook("8/8/4k3/8/2R5/4K3/8/8 w - - 0 1");
+
+    auto r = search2.initiateIterativeSearch<WHITE>(rook, 10);
+    CHECK(r.multiCuts > 0);
+    CHECK(is_legal_move<WHITE>(rook, r.selectedMove));
+    CHECK(r.score > 300);
+    CHECK(stackIsClean(search2));
+}
+
+TEST_CASE("Search: internal iterative reduction keeps mates and their first moves") {
+    struct Problem { const char* fen; int moves; const char* first; };
+    const Problem problems[] = {
+        { "rn1qkbnr/ppp2p1p/3p2p1/4N3/2B1P3/2N5/PPPP1PPP/R1BbK2R w KQkq - 0 1", 2, "c4f7" },
+        { "4kb1r/p2n1ppp/4q3/4p1B1/4P3/1Q6/PPP2PPP/2KR4 w k - 0 1", 2, "b3b8" },
+        { "6k1/pp4p1/2p5/2bp4/8/P5Pb/1P3rrP/2BRRN1K b - - 0 1", 2, "g2g1" },
+        { "r1bq2r1/b4pk1/p1pp1p2/1p2pP2/1P2P1PB/3P4/1PPQ2P1/R3K2R w - - 0 1", 2, "d2h6" },
+        { "r1b2k1r/ppp1bppp/8/1B1Q4/5q2/2P5/PPP2PPP/R3R1K1 w - - 0 1", 2, "d5d8" },
+        { "r1b1kb1r/pppp1ppp/5q2/4n3/3KP3/2N3PN/PPP4P/R1BQ1B1R b kq - 0 1", 3, "f8c5" },
+        { "2r3k1/p4p2/3Rp2p/1p2P1pK/8/1P4P1/P3Q2P/1q6 b - - 0 1", 3, "b1g6" },
+        { "r5rk/5p1p/5R2/4B3/8/8/7P/7K w - - 0 1", 3, "f6a6" },
+    };
+
+    // Depth 6 leaves nodes at IIR_MIN_DEPTH and above without a hash move, so the reduction is in play
+    long long reduced = 0;
+    for (const Problem& pr : problems) {
+        CAPTURE(pr.fen);
+        bq::Search search(50);
+        Position p(pr.fen);
+
+        auto s = (p.turn() == WHITE) ? search.initiateIterativeSearch<WHITE>(p, 6)
+                                     : search.initiateIterativeSearch<BLACK>(p, 6);
+        reduced += s.iirReductions;
+
+        CHECK(s.mateFound);
+        CHECK(s.score == bq::Search::CHECKMATE_SCORE - (2 * pr.moves - 1));
+        CHECK(s.selectedMove.str() == pr.first);
+    }
+    CHECK(reduced > 0);
+}
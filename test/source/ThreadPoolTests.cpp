@@ -0,0 +1,49 @@
+#include "doctest.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "ThreadPool.h"
+
+TEST_CASE("ThreadPool: a worker runs every job on the same long-lived thread") {
+    bq::ThreadPool pool(1);
+
+    std::thread::id first, second;
+    pool.main().start([&] { first = std::this_thread::get_id(); });
+    pool.main().wait();
+    pool.main().start([&] { second = std::this_thread::get_id(); });
+    pool.main().wait();
+
+    CHECK(first == second);
+    CHECK(first != std::this_thread::get_id());
+}
+
+TEST_CASE("ThreadPool: wait blocks until the job has returned") {
+    bq::ThreadPool pool(1);
+    std::atomic<bool> done{ false };
+
+    pool.main().start([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        done = true;
+    });
+    pool.main().wait();
+
+    CHECK(done);
+    CHECK_FALSE(pool.main().busy());
+}
+
+TEST_CASE("ThreadPool: resize rebuilds workers only when the count changes") {
+    bq::ThreadPool pool(2);
+    REQUIRE(pool.size() == 2);
+
+    bq::SearchWorker* before = &pool.main();
+    pool.resize(2);
+    CHECK(&pool.main() == before);
+
+    pool.resize(4);
+    CHECK(pool.size() == 4);
+
+    pool.resize(0);
+    CHECK(pool.size() == 1);
+}
@@ -0,0 +1,114 @@
+#include "doctest.h"
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "surge.h"
+#include "UciClient.h"
+
+namespace {
+
+    struct UciSession {
+        std::istringstream in;
+        std::ostringstream out;
+        bq::UciClient client;
+    };
+
+    // Feeds the commands to a UciClient in one write, the way a GUI sends them back to back, and returns what it
+    // printed. Returns nothing when the client has not finished within the timeout; a hung search cannot be
+    // joined, so the session is then left behind on its own thread.
+    std::optional<std::string> runUci(const std::string& commands, std::chrono::seconds timeout) {
+        auto session = std::make_shared<UciSession>();
+        session->in.str(commands);
+
+        auto done = std::make_shared<std::promise<void>>();
+        std::future<void> finished = done->get_future();
+        std::thread([session, done] {
+            session->client.run(session->in, session->out);
+            done->set_value();
+        }).detach();
+
+        if (finished.wait_for(timeout) != std::future_status::ready)
+            return std::nullopt;
+        return session->out.str();
+    }
+
+    // Out of book, so the search runs rather than the book answering at once
+    const std::string kMiddlegame = "position fen r2q1rk1/1b1nbppp/p2ppn2/1p6/3NP3/1BN1BP2/PPPQ2PP/2KR3R w - - 0 12\n";
+
+}
+
+TEST_SUITE("bq::UciClient") {
+
+    TEST_CASE("stop right behind go ponder still ends the search with a bestmove") {
+        const auto out = runUci(kMiddlegame + "go ponder wtime 10000 btime 10000\nstop\n", std::chrono::seconds(10));
+        REQUIRE(out.has_value());
+        CHECK(out->find("bestmove ") != std::string::npos);
+    }
+
+    TEST_CASE("stop right behind go infinite still ends the search with a bestmove") {
+        const auto out = runUci(kMiddlegame + "go infinite\nstop\n", std::chrono::seconds(10));
+        REQUIRE(out.has_value());
+        CHECK(out->find("bestmove ") != std::string::npos);
+    }
+
+    TEST_CASE("bench reports its totals and a bad depth does not end the engine") {
+        const auto out = runUci("bench 1\nbench deep\nisready\n", std::chrono::seconds(30));
+        REQUIRE(out.has_value());
+        CHECK(out->find("Nodes searched") != std::string::npos);
+        CHECK(out->find("bad depth 'deep'") != std::string::npos);
+        CHECK(out->find("readyok") != std::string::npos);
+    }
+
+    TEST_CASE("bench eval reports its totals and bad rounds do not end the engine") {
+        const auto out = runUci("bench eval 1\nbench eval many\nisready\n", std::chrono::seconds(30));
+        REQUIRE(out.has_value());
+        CHECK(out->find("Evaluations") != std::string::npos);
+        CHECK(out->find("bad rounds 'many'") != std::string::npos);
+        CHECK(out->find("readyok") != std::string::npos);
+    }
+
+    TEST_CASE("a bad Threads value is reported and does not end the engine") {
+        const auto out = runUci("setoption name Threads value x\nisready\n", std::chrono::seconds(10));
+        REQUIRE(out.has_value());
+        CHECK(out->find("info string bad Threads value") != std::string::npos);
+        CHECK(out->find("readyok") != std::string::npos);
+    }
+
+    TEST_CASE("a bad MultiPV value is reported and leaves a single line") {
+        const auto out = runUci("setoption name MultiPV value two\n" + kMiddlegame + "go depth 3\nisready\n",
+                                std::chrono::seconds(20));
+        REQUIRE(out.has_value());
+        CHECK(out->find("info string bad MultiPV value") != std::string::npos);
+        CHECK(out->find("multipv 2") == std::string::npos);
+        CHECK(out->find("bestmove ") != std::string::npos);
+    }
+
+    TEST_CASE("a bad go nodes value is reported and the search still answers") {
+        const auto out = runUci(kMiddlegame + "go depth 2 nodes lots\nisready\n", std::chrono::seconds(20));
+        REQUIRE(out.has_value());
+        CHECK(out->find("info string go: bad nodes 'lots'") != std::string::npos);
+        CHECK(out->find("bestmove ") != std::string::npos);
+    }
+
+    TEST_CASE("stop right behind solve ends the mate search promptly") {
+        // No mate within the default length here, and proving that takes the solver many seconds
+        const auto out = runUci("position fen r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4\n"
+                                "solve\nstop\nisready\n", std::chrono::seconds(3));
+        REQUIRE(out.has_value());
+        CHECK(out->find("mate search stopped") != std::string::npos);
+        CHECK(out->find("readyok") != std::string::npos);
+    }
+
+    TEST_CASE("solve with a bad mate length does not end the engine") {
+        const auto out = runUci("solve mate two\nisready\n", std::chrono::seconds(10));
+        REQUIRE(out.has_value());
+        CHECK(out->find("bad mate 'two'") != std::string::npos);
+        CHECK(out->find("readyok") != std::string::npos);
+    }
+}